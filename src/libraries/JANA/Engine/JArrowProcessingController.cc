@@ -26,12 +26,18 @@ void JArrowProcessingController::acquire_services(JServiceLocator * sl) {
     params->SetDefaultParameter("jana:timeout", m_timeout_s, "Max time (in seconds) JANA will wait for a thread to update its heartbeat before hard-exiting. 0 to disable timeout completely.");
     params->SetDefaultParameter("jana:warmup_timeout", m_warmup_timeout_s, "Max time (in seconds) JANA will wait for 'initial' events to complete before hard-exiting.");
     // Originally "THREAD_TIMEOUT" and "THREAD_TIMEOUT_FIRST_EVENT"
+    params->SetDefaultParameter("jana:scheduler_policy", m_scheduler_policy, "Order in which workers are offered arrows. Options: 'backpressure' (prefer arrows with pending input and free output space), 'round_robin'")
+        ->SetIsAdvanced(true);
+    params->SetDefaultParameter("jana:sticky_assignments", m_sticky_assignments, "Let workers keep their arrow while it has input and its output isn't congested, instead of going back to the scheduler after every checkin")
+        ->SetIsAdvanced(true);
 }
 
 void JArrowProcessingController::initialize() {
 
     m_scheduler = new JScheduler(m_topology);
     m_scheduler->logger = m_scheduler_logger;
+    m_scheduler->set_policy(JSchedulingPolicy::create(m_scheduler_policy, m_topology->arrows.size()));
+    m_scheduler->set_sticky_assignments(m_sticky_assignments);
     LOG_INFO(m_logger) << m_topology->mapping << LOG_END;
 
     m_scheduler->initialize_topology();
@@ -52,17 +58,8 @@ void JArrowProcessingController::run(size_t nthreads) {
     // run_topology needs to happen _before_ threads are started so that threads don't quit due to lack of assignments
     m_scheduler->run_topology(nthreads);
 
-    bool pin_to_cpu = (m_topology->mapping.get_affinity() != JProcessorMapping::AffinityStrategy::None);
-
-    size_t next_worker_id = 0;
-    while (next_worker_id < nthreads) {
-        size_t next_cpu_id = m_topology->mapping.get_cpu_id(next_worker_id);
-        size_t next_loc_id = m_topology->mapping.get_loc_id(next_worker_id);
-        auto worker = new JWorker(this, m_scheduler, next_worker_id, next_cpu_id, next_loc_id, pin_to_cpu);
-        worker->logger = m_worker_logger;
-        m_workers.push_back(worker);
-        next_worker_id++;
-    }
+    std::lock_guard<std::mutex> lock(m_workers_mutex);
+    add_workers_unprotected(nthreads);
     for (size_t i=0; i<nthreads; ++i) {
         m_workers.at(i)->start();
     };
@@ -71,16 +68,60 @@ void JArrowProcessingController::run(size_t nthreads) {
     // the supervisor thread waiting forever for workers to reach RunState::Running when they've already Stopped.
 }
 
+/// @brief Changes the number of worker threads.
+///
+/// If the topology is running, this adds or retires individual workers without pausing it. New workers start
+/// picking up assignments immediately, and retiring workers finish whatever they are executing first. Otherwise,
+/// the workers are (re)created and the topology is started with `nthreads` workers.
 void JArrowProcessingController::scale(size_t nthreads) {
 
+    auto status = m_scheduler->get_topology_status();
+    if (status == JScheduler::TopologyStatus::Running || status == JScheduler::TopologyStatus::Draining) {
+
+        std::lock_guard<std::mutex> lock(m_workers_mutex);
+        size_t current_nthreads = m_workers.size();
+        if (nthreads > current_nthreads) {
+            LOG_INFO(m_logger) << "scale(): Adding " << nthreads - current_nthreads << " workers" << LOG_END;
+            add_workers_unprotected(nthreads);
+            for (size_t i=current_nthreads; i<nthreads; ++i) {
+                m_workers.at(i)->start();
+            }
+        }
+        else if (nthreads < current_nthreads) {
+            LOG_INFO(m_logger) << "scale(): Retiring " << current_nthreads - nthreads << " workers" << LOG_END;
+            retire_workers_unprotected(nthreads);
+        }
+        // Restart the stopwatch so that throughput is measured against the new thread count
+        m_topology->metrics.reset();
+        m_topology->metrics.start(get_monotonic_event_count(), nthreads);
+        return;
+    }
+
     LOG_INFO(m_logger) << "scale(): Stopping all running workers" << LOG_END;
     m_scheduler->request_topology_pause();
+    std::lock_guard<std::mutex> lock(m_workers_mutex);
     for (JWorker* worker : m_workers) {
         worker->wait_for_stop();
     }
     m_scheduler->achieve_topology_pause();
 
     LOG_INFO(m_logger) << "scale(): All workers are stopped" << LOG_END;
+    retire_workers_unprotected(nthreads);
+    add_workers_unprotected(nthreads);
+
+    LOG_INFO(m_logger) << "scale(): Restarting " << nthreads << " workers" << LOG_END;
+    // topology->run needs to happen _before_ threads are started so that threads don't quit due to lack of assignments
+    m_scheduler->run_topology(nthreads);
+
+    for (size_t i=0; i<nthreads; ++i) {
+        m_workers.at(i)->start();
+    };
+}
+
+/// Creates (but doesn't start) workers until there are `nthreads` of them. Worker ids stay contiguous,
+/// so each new worker gets the cpu and memory location that JProcessorMapping assigns to its id.
+void JArrowProcessingController::add_workers_unprotected(size_t nthreads) {
+
     bool pin_to_cpu = (m_topology->mapping.get_affinity() != JProcessorMapping::AffinityStrategy::None);
     size_t next_worker_id = m_workers.size();
 
@@ -94,14 +135,34 @@ void JArrowProcessingController::scale(size_t nthreads) {
         m_workers.push_back(worker);
         next_worker_id++;
     }
+}
 
-    LOG_INFO(m_logger) << "scale(): Restarting " << nthreads << " workers" << LOG_END;
-    // topology->run needs to happen _before_ threads are started so that threads don't quit due to lack of assignments
-    m_scheduler->run_topology(nthreads);
+/// Stops and deletes the workers with the highest ids until only `nthreads` remain. Each worker finishes
+/// its current execute() and hands its assignment back to the scheduler before its thread is joined.
+void JArrowProcessingController::retire_workers_unprotected(size_t nthreads) {
 
-    for (size_t i=0; i<nthreads; ++i) {
-        m_workers.at(i)->start();
-    };
+    for (size_t i=nthreads; i<m_workers.size(); ++i) {
+        m_workers[i]->request_stop();
+    }
+    for (size_t i=nthreads; i<m_workers.size(); ++i) {
+        m_workers[i]->wait_for_stop();
+        delete m_workers[i];
+    }
+    if (nthreads < m_workers.size()) {
+        m_workers.resize(nthreads);
+    }
+}
+
+size_t JArrowProcessingController::get_monotonic_event_count() {
+    size_t monotonic_event_count = 0;
+    for (JArrow* arrow : m_topology->arrows) {
+        if (arrow->is_sink()) {
+            JArrowMetrics metrics;
+            m_scheduler->collect_arrow_metrics(arrow->get_index(), metrics);
+            monotonic_event_count += metrics.get_total_message_count();
+        }
+    }
+    return monotonic_event_count;
 }
 
 void JArrowProcessingController::request_pause() {
@@ -113,6 +174,7 @@ void JArrowProcessingController::request_pause() {
 }
 
 void JArrowProcessingController::wait_until_paused() {
+    std::lock_guard<std::mutex> lock(m_workers_mutex);
     for (JWorker* worker : m_workers) {
         worker->wait_for_stop();
     }
@@ -136,8 +198,11 @@ void JArrowProcessingController::request_stop() {
 
 void JArrowProcessingController::wait_until_stopped() {
     // Join all workers
-    for (JWorker* worker : m_workers) {
-        worker->wait_for_stop();
+    {
+        std::lock_guard<std::mutex> lock(m_workers_mutex);
+        for (JWorker* worker : m_workers) {
+            worker->wait_for_stop();
+        }
     }
     // finish out the topology
     // (note some arrows might have already finished e.g. event sources, but that's fine, finish() is idempotent)
@@ -177,7 +242,8 @@ bool JArrowProcessingController::is_timed_out() {
 
     // Find all workers whose last heartbeat exceeds timeout
     bool found_timeout = false;
-    for (size_t i=0; i<metrics->workers.size(); ++i) {
+    std::lock_guard<std::mutex> lock(m_workers_mutex);
+    for (size_t i=0; i<metrics->workers.size() && i<m_workers.size(); ++i) {
         if (metrics->workers[i].last_heartbeat_ms > (timeout_s * 1000)) {
             found_timeout = true;
             m_workers[i]->declare_timeout();
@@ -189,6 +255,7 @@ bool JArrowProcessingController::is_timed_out() {
 }
 
 bool JArrowProcessingController::is_excepted() {
+    std::lock_guard<std::mutex> lock(m_workers_mutex);
     for (auto worker : m_workers) {
         if (worker->get_runstate() == JWorker::RunState::Excepted) {
             return true;
@@ -199,6 +266,7 @@ bool JArrowProcessingController::is_excepted() {
 
 std::vector<JException> JArrowProcessingController::get_exceptions() const {
     std::vector<JException> exceptions;
+    std::lock_guard<std::mutex> lock(m_workers_mutex);
     for (auto worker : m_workers) {
         if (worker->get_runstate() == JWorker::RunState::Excepted) {
             exceptions.push_back(worker->get_exception());
@@ -244,6 +312,7 @@ std::unique_ptr<const JPerfSummary> JArrowProcessingController::measure_performa
 
     // Measure perf on all Workers first, as this will prompt them to publish
     // any ArrowMetrics they have collected
+    std::lock_guard<std::mutex> lock(m_workers_mutex);
     if (m_perf_summary.workers.size() != m_workers.size()) {
         m_perf_summary.workers = std::vector<WorkerSummary>(m_workers.size());
     }
@@ -251,12 +320,7 @@ std::unique_ptr<const JPerfSummary> JArrowProcessingController::measure_performa
         m_workers[i]->measure_perf(m_perf_summary.workers[i]);
     }
 
-    size_t monotonic_event_count = 0;
-    for (JArrow* arrow : m_topology->arrows) {
-        if (arrow->is_sink()) {
-            monotonic_event_count += arrow->get_metrics().get_total_message_count();
-        }
-    }
+    size_t monotonic_event_count = get_monotonic_event_count();
 
     // Uptime
     m_topology->metrics.split(monotonic_event_count);
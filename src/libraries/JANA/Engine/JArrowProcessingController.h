@@ -8,6 +8,7 @@
 #include <JANA/Engine/JWorker.h>
 #include <JANA/Engine/JPerfSummary.h>
 
+#include <mutex>
 #include <vector>
 
 class JArrowProcessingController : public JService {
@@ -48,14 +49,21 @@ private:
     using jclock_t = std::chrono::steady_clock;
     int m_timeout_s = 8;
     int m_warmup_timeout_s = 30;
+    std::string m_scheduler_policy = "backpressure";
+    bool m_sticky_assignments = false;
 
     JPerfSummary m_perf_summary;
     JScheduler* m_scheduler = nullptr;
 
     std::vector<JWorker*> m_workers;
+    mutable std::mutex m_workers_mutex;  // scale() may run concurrently with the supervisor thread's measurements
     JLogger m_logger;
     JLogger m_worker_logger;
     JLogger m_scheduler_logger;
 
+    void add_workers_unprotected(size_t nthreads);
+    void retire_workers_unprotected(size_t nthreads);
+    size_t get_monotonic_event_count();
+
 };
 
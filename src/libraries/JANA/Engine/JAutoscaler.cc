@@ -0,0 +1,160 @@
+// Copyright 2024, Jefferson Science Associates, LLC.
+// Subject to the terms in the LICENSE file found in the top-level directory.
+
+#include <JANA/Engine/JAutoscaler.h>
+#include <JANA/Engine/JArrowProcessingController.h>
+#include <JANA/Services/JLoggingService.h>
+#include <JANA/Services/JParameterManager.h>
+#include <JANA/Utils/JCpuInfo.h>
+#include <JANA/JApplication.h>
+
+#include <algorithm>
+
+
+void JAutoscaler::acquire_services(JServiceLocator* sl) {
+
+    SetLogger(sl->get<JLoggingService>()->get_logger("JAutoscaler"));
+    m_processing_controller = sl->get<JArrowProcessingController>();
+
+    auto params = sl->get<JParameterManager>();
+    params->SetDefaultParameter("jana:autoscale", m_enabled, "Adjust the number of worker threads while running, by hill-climbing on throughput");
+    params->SetDefaultParameter("jana:autoscale_min", m_min_nthreads, "Fewest worker threads the autoscaler may use")
+        ->SetIsAdvanced(true);
+    params->SetDefaultParameter("jana:autoscale_max", m_max_nthreads, "Most worker threads the autoscaler may use. 0: number of cpus")
+        ->SetIsAdvanced(true);
+    params->SetDefaultParameter("jana:autoscale_interval_ms", m_interval_ms, "Length of the window over which the autoscaler measures throughput before each decision")
+        ->SetIsAdvanced(true);
+
+    set_bounds(m_min_nthreads, m_max_nthreads);
+}
+
+
+void JAutoscaler::set_bounds(size_t min_nthreads, size_t max_nthreads) {
+    if (max_nthreads == 0) {
+        max_nthreads = JCpuInfo::GetNumCpus();
+    }
+    if (min_nthreads == 0 || min_nthreads > max_nthreads) {
+        throw JException("Invalid autoscaler bounds: jana:autoscale_min=%zu, jana:autoscale_max=%zu", min_nthreads, max_nthreads);
+    }
+    m_min_nthreads = min_nthreads;
+    m_max_nthreads = max_nthreads;
+}
+
+
+bool JAutoscaler::tick() {
+
+    if (!m_enabled) return false;
+
+    auto status = m_processing_controller->get_scheduler()->get_topology_status();
+    if (status != JScheduler::TopologyStatus::Running) {
+        // Draining, pausing, or done. Nothing we measure now says anything about the right thread count.
+        m_window_started = false;
+        return false;
+    }
+
+    auto summary = m_processing_controller->measure_performance();
+    if (!m_window_started) {
+        start_window(*summary);
+        return false;
+    }
+
+    auto elapsed = clock_t::now() - m_window_start_time;
+    if (elapsed < std::chrono::milliseconds(m_interval_ms)) return false;
+
+    double elapsed_s = std::chrono::duration<double>(elapsed).count();
+    double throughput_hz = (summary->monotonic_events_completed - m_window_start_event_count) / elapsed_s;
+    double idle_frac = get_idle_frac(*summary);
+    size_t current_nthreads = summary->workers.size();
+
+    size_t new_nthreads = decide(current_nthreads, throughput_hz, idle_frac);
+    if (new_nthreads != current_nthreads) {
+        GetApplication()->Scale(new_nthreads);
+        // The new window starts after the scale, so that it doesn't include the old thread count
+        summary = m_processing_controller->measure_performance();
+    }
+    start_window(*summary);
+    return new_nthreads != current_nthreads;
+}
+
+
+size_t JAutoscaler::decide(size_t current_nthreads, double throughput_hz, double idle_frac) {
+
+    int direction = m_direction;
+    std::string reason;
+
+    if (idle_frac > m_idle_threshold) {
+        // Extra threads can't help, so don't bounce off the lower bound either
+        direction = (current_nthreads > m_min_nthreads) ? -1 : 0;
+        reason = (direction < 0) ? "workers were mostly idle" : "workers were mostly idle, but already at jana:autoscale_min";
+    }
+    else if (m_prev_nthreads == 0 || m_prev_nthreads == current_nthreads) {
+        reason = "probing";
+    }
+    else {
+        double gain = (m_prev_throughput_hz > 0) ? (throughput_hz - m_prev_throughput_hz) / m_prev_throughput_hz : 1.0;
+        int last_move = (current_nthreads > m_prev_nthreads) ? 1 : -1;
+        if (gain > m_tolerance) {
+            direction = last_move;
+            reason = "throughput improved";
+        }
+        else if (gain < -m_tolerance) {
+            direction = -last_move;
+            reason = "throughput dropped";
+        }
+        else {
+            direction = -1;
+            reason = "throughput unchanged, preferring fewer threads";
+        }
+    }
+
+    // Bounce off the bounds, so that we keep probing instead of getting stuck
+    if (direction > 0 && current_nthreads >= m_max_nthreads) {
+        direction = -1;
+        reason += ", but already at jana:autoscale_max";
+    }
+    else if (direction < 0 && current_nthreads <= m_min_nthreads) {
+        direction = 1;
+        reason += ", but already at jana:autoscale_min";
+    }
+
+    size_t new_nthreads = current_nthreads + direction;
+    new_nthreads = std::min(std::max(new_nthreads, m_min_nthreads), m_max_nthreads);
+
+    m_prev_nthreads = current_nthreads;
+    m_prev_throughput_hz = throughput_hz;
+    if (direction != 0) {
+        m_direction = direction;
+    }
+    m_decisions.push_back({current_nthreads, new_nthreads, throughput_hz, idle_frac, reason});
+
+    LOG_INFO(GetLogger()) << "Rescaling " << current_nthreads << " => " << new_nthreads << " threads ("
+                          << reason << "; throughput=" << throughput_hz << " Hz, idle=" << idle_frac*100 << "%)" << LOG_END;
+    return new_nthreads;
+}
+
+
+void JAutoscaler::start_window(const JPerfSummary& summary) {
+    m_window_started = true;
+    m_window_start_time = clock_t::now();
+    m_window_start_event_count = summary.monotonic_events_completed;
+    m_window_start_workers = summary.workers;
+}
+
+
+double JAutoscaler::get_idle_frac(const JPerfSummary& summary) {
+    double useful_ms = 0, idle_ms = 0;
+    for (size_t i=0; i<summary.workers.size(); ++i) {
+        const WorkerSummary& now = summary.workers[i];
+        // Workers created during the window (or recreated by a pause-and-restart) start counting from zero
+        bool is_same_worker = (i < m_window_start_workers.size()) &&
+                              (now.total_useful_time_ms >= m_window_start_workers[i].total_useful_time_ms);
+        const WorkerSummary* before = is_same_worker ? &m_window_start_workers[i] : nullptr;
+
+        useful_ms += now.total_useful_time_ms - (before ? before->total_useful_time_ms : 0);
+        idle_ms += now.total_idle_time_ms - (before ? before->total_idle_time_ms : 0);
+        idle_ms += now.total_retry_time_ms - (before ? before->total_retry_time_ms : 0);
+    }
+    double total_ms = useful_ms + idle_ms;
+    return (total_ms > 0) ? idle_ms / total_ms : 0;
+}
+
@@ -0,0 +1,80 @@
+// Copyright 2024, Jefferson Science Associates, LLC.
+// Subject to the terms in the LICENSE file found in the top-level directory.
+
+#pragma once
+#include <JANA/JService.h>
+#include <JANA/JLogger.h>
+#include <JANA/Engine/JPerfSummary.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+class JArrowProcessingController;
+
+/// JAutoscaler adjusts the number of worker threads while the topology is running, for machines where the
+/// best thread count depends on whatever else is running there. It is off unless `jana:autoscale` is set.
+///
+/// JApplication::Run() calls tick() on every ticker interval. Once a full measurement window has elapsed, the
+/// autoscaler computes the throughput over that window, and hill-climbs: it keeps moving the thread count in the
+/// same direction while throughput improves, turns around when throughput drops, and prefers fewer threads
+/// when the difference is within noise. Independently of throughput, it steps down when the workers spent most
+/// of the window idle or backing off, since extra threads can't help in that case, and stays put if it is already
+/// at jana:autoscale_min. Each decision is logged at
+/// INFO level and recorded, so that it can be audited afterwards.
+class JAutoscaler : public JService {
+public:
+    struct Decision {
+        size_t old_nthreads;
+        size_t new_nthreads;
+        double throughput_hz;
+        double idle_frac;     // Fraction of worker time spent idle or backing off instead of executing arrows
+        std::string reason;
+    };
+
+    void acquire_services(JServiceLocator*) override;
+
+    bool is_enabled() const { return m_enabled; }
+    void set_enabled(bool enabled) { m_enabled = enabled; }
+    void set_bounds(size_t min_nthreads, size_t max_nthreads);
+
+    /// Measures, and rescales via JApplication::Scale() if a window has elapsed and the controller asks for it.
+    /// Returns true if the thread count was changed.
+    bool tick();
+
+    /// The controller itself: given the thread count and measurements for the window that just ended, returns the
+    /// thread count for the next window, and records the decision. Separate from tick() so that it can be tested.
+    size_t decide(size_t current_nthreads, double throughput_hz, double idle_frac);
+
+    const std::vector<Decision>& get_decisions() const { return m_decisions; }
+
+private:
+    using clock_t = std::chrono::steady_clock;
+
+    bool m_enabled = false;
+    size_t m_min_nthreads = 1;
+    size_t m_max_nthreads = 0;         // 0 means the number of cpus
+    int m_interval_ms = 5000;          // Length of a measurement window
+    double m_tolerance = 0.05;         // Relative throughput change that we consider noise
+    double m_idle_threshold = 0.5;     // Above this idle fraction, we step down regardless of throughput
+
+    std::shared_ptr<JArrowProcessingController> m_processing_controller;
+
+    // Current measurement window
+    bool m_window_started = false;
+    clock_t::time_point m_window_start_time;
+    size_t m_window_start_event_count = 0;
+    std::vector<WorkerSummary> m_window_start_workers;
+
+    // Hill-climbing state
+    size_t m_prev_nthreads = 0;
+    double m_prev_throughput_hz = 0;
+    int m_direction = 1;
+
+    std::vector<Decision> m_decisions;
+
+    void start_window(const JPerfSummary& summary);
+    double get_idle_frac(const JPerfSummary& summary);
+};
+
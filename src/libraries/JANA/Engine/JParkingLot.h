@@ -0,0 +1,108 @@
+// Copyright 2024, Jefferson Science Associates, LLC.
+// Subject to the terms in the LICENSE file found in the top-level directory.
+
+#pragma once
+#include <JANA/Utils/JCpuInfo.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+/// JParkingLot is where JWorkers wait when they have nothing useful to do, instead of sleeping for a fixed
+/// backoff or exiting. Anything that might create work (a JMailbox or JPool push, an arrow becoming available,
+/// a topology status change) calls notify(), which wakes the waiting workers so that they can try again.
+///
+/// The protocol is:
+///   1. begin_waiting(), then read get_epoch()
+///   2. Look for work once more. This closes the race with a notify() that happened before step 1.
+///   3. If there still isn't any, wait(epoch, ...), and go back to 2
+///   4. end_waiting() once work has been found
+///
+/// Steps 1 and 2 race with a push followed by notify(), so the protocol needs a store-load barrier on both sides:
+/// otherwise the notifier could read a stale waiting count of 0 while the waiter misses the pushed item. A full
+/// fence per push costs about as much as an uncontended JMailbox push itself. Where the OS provides an asymmetric
+/// barrier (membarrier(2) on Linux, see JCpuInfo::HeavyBarrier), begin_waiting() pays for it instead, since
+/// a worker that is about to wait is off the hot path, and notify() with nobody waiting is a compiler-only barrier
+/// plus one relaxed load. Elsewhere notify() falls back to a seq_cst fence and load on every push.
+///
+/// wait() spins briefly before blocking on a condition variable. The spin budget is per-caller and adapts:
+/// it grows when work shows up while spinning, and shrinks when the caller ends up blocking anyway.
+
+class JParkingLot {
+public:
+    using duration_t = std::chrono::steady_clock::duration;
+
+    static constexpr size_t MIN_SPIN_COUNT = 16;
+    static constexpr size_t MAX_SPIN_COUNT = 4096;
+
+private:
+    alignas(JANA2_CACHE_LINE_BYTES) std::atomic<size_t> m_waiting_count {0};
+    alignas(JANA2_CACHE_LINE_BYTES) std::atomic<uint64_t> m_epoch {0};
+    alignas(JANA2_CACHE_LINE_BYTES) std::atomic<size_t> m_parked_count {0};
+    const bool m_has_heavy_barrier = JCpuInfo::HasHeavyBarrier();
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+
+public:
+
+    void begin_waiting() {
+        m_waiting_count.fetch_add(1);
+        // Pairs with the signal fence in notify(). Every notifier that still read a waiting count of 0 has made its
+        // push visible by the time this returns, so the caller's second look for work (step 2) will find it.
+        if (m_has_heavy_barrier) JCpuInfo::HeavyBarrier();
+    }
+
+    void end_waiting() { m_waiting_count.fetch_sub(1); }
+
+    uint64_t get_epoch() const { return m_epoch.load(); }
+
+    size_t get_waiting_count() const { return m_waiting_count.load(); }
+
+    size_t get_parked_count() const { return m_parked_count.load(); }
+
+    void notify() {
+        // Pairs with begin_waiting(), so that either we see the waiter or it sees our push
+        if (m_has_heavy_barrier) {
+            std::atomic_signal_fence(std::memory_order_seq_cst);
+            if (m_waiting_count.load(std::memory_order_relaxed) == 0) return;
+        }
+        else {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (m_waiting_count.load() == 0) return;
+        }
+        m_epoch.fetch_add(1);
+        if (m_parked_count.load() != 0) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_cv.notify_all();
+        }
+    }
+
+    /// Waits until somebody calls notify() after `seen_epoch` was read, or until `timeout` elapses.
+    /// Returns true if woken by a notify(), false on timeout.
+    bool wait(uint64_t seen_epoch, size_t& spin_budget, duration_t timeout) {
+
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        spin_budget = std::min(std::max(spin_budget, MIN_SPIN_COUNT), MAX_SPIN_COUNT);
+
+        for (size_t i=0; i<spin_budget; ++i) {
+            if (m_epoch.load(std::memory_order_acquire) != seen_epoch) {
+                spin_budget = std::min(spin_budget * 2, MAX_SPIN_COUNT);
+                return true;
+            }
+            if (std::chrono::steady_clock::now() >= deadline) {
+                return false;
+            }
+            std::this_thread::yield();
+        }
+        spin_budget = std::max(spin_budget / 2, MIN_SPIN_COUNT);
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_parked_count.fetch_add(1);
+        bool notified = m_cv.wait_until(lock, deadline, [&]{ return m_epoch.load() != seen_epoch; });
+        m_parked_count.fetch_sub(1);
+        return notified;
+    }
+};
+
@@ -22,9 +22,9 @@ std::ostream& operator<<(std::ostream& os, const JPerfSummary& s) {
     os << "  Efficiency [0..1]:           " << std::setprecision(3) << s.avg_efficiency_frac << std::endl;
     os << std::endl;
 
-    os << "  +--------------------------+--------+-----+---------+-------+--------+---------+-------------+" << std::endl;
-    os << "  |           Name           |  Type  | Par | Threads | Chunk | Thresh | Pending |  Completed  |" << std::endl;
-    os << "  +--------------------------+--------+-----+---------+-------+--------+---------+-------------+" << std::endl;
+    os << "  +--------------------------+--------+-----+---------+-------+--------+---------+----------+-------------+" << std::endl;
+    os << "  |           Name           |  Type  | Par | Threads | Chunk | Thresh | Pending |  Stolen  |  Completed  |" << std::endl;
+    os << "  +--------------------------+--------+-----+---------+-------+--------+---------+----------+-------------+" << std::endl;
 
     for (auto as : s.arrows) {
         os << "  | "
@@ -37,16 +37,17 @@ std::ostream& operator<<(std::ostream& os, const JPerfSummary& s) {
         if (!as.is_source) {
 
             os << std::setw(7) << as.threshold << " |"
-               << std::setw(8) << as.messages_pending << " |";
+               << std::setw(8) << as.messages_pending << " |"
+               << std::setw(9) << as.steal_count << " |";
         }
         else {
 
-            os << "      - |       - |";
+            os << "      - |       - |        - |";
         }
         os << std::setw(12) << as.total_messages_completed << " |"
            << std::endl;
     }
-    os << "  +--------------------------+--------+-----+---------+-------+--------+---------+-------------+" << std::endl;
+    os << "  +--------------------------+--------+-----+---------+-------+--------+---------+----------+-------------+" << std::endl;
 
 
     os << "  +--------------------------+-------------+--------------+----------------+--------------+----------------+" << std::endl;
@@ -67,10 +68,10 @@ std::ostream& operator<<(std::ostream& os, const JPerfSummary& s) {
     os << "  +--------------------------+-------------+--------------+----------------+--------------+----------------+" << std::endl;
 
 
-    os << "  +----+----------------------+-------------+------------+-----------+----------------+------------------+" << std::endl;
-    os << "  | ID | Last arrow name      | Useful time | Retry time | Idle time | Scheduler time | Scheduler visits |" << std::endl;
-    os << "  |    |                      |     [ms]    |    [ms]    |    [ms]   |      [ms]      |     [count]      |" << std::endl;
-    os << "  +----+----------------------+-------------+------------+-----------+----------------+------------------+" << std::endl;
+    os << "  +----+----------------------+-------------+------------+-----------+----------------+------------------+------------+" << std::endl;
+    os << "  | ID | Last arrow name      | Useful time | Retry time | Idle time | Scheduler time | Scheduler visits | Migrations |" << std::endl;
+    os << "  |    |                      |     [ms]    |    [ms]    |    [ms]   |      [ms]      |     [count]      |   [count]  |" << std::endl;
+    os << "  +----+----------------------+-------------+------------+-----------+----------------+------------------+------------+" << std::endl;
 
     for (auto ws : s.workers) {
         os << "  |"
@@ -81,9 +82,10 @@ std::ostream& operator<<(std::ostream& os, const JPerfSummary& s) {
            << std::setw(10) << ws.last_idle_time_ms << " |"
            << std::setw(15) << ws.last_scheduler_time_ms << " |"
            << std::setw(17) << ws.scheduler_visit_count << " |"
+           << std::setw(11) << ws.migration_count << " |"
            << std::endl;
     }
-    os << "  +----+----------------------+-------------+------------+-----------+----------------+------------------+" << std::endl;
+    os << "  +----+----------------------+-------------+------------+-----------+----------------+------------------+------------+" << std::endl;
     return os;
 }
 
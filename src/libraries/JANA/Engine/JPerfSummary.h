@@ -16,6 +16,7 @@ struct ArrowSummary {
     int running_upstreams;
     bool has_backpressure;
     size_t messages_pending;
+    size_t steal_count;
     size_t threshold;
     size_t chunksize;
 
@@ -43,6 +44,7 @@ struct WorkerSummary {
     double last_idle_time_ms;
     double last_scheduler_time_ms;
     long scheduler_visit_count;
+    size_t migration_count;         // Times this worker was moved from one arrow straight to a different one
     std::string last_arrow_name;
     double last_arrow_avg_latency_ms;
     double last_arrow_avg_queue_latency_ms;
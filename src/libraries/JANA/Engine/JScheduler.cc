@@ -2,8 +2,6 @@
 // Copyright 2020, Jefferson Science Associates, LLC.
 // Subject to the terms in the LICENSE file found in the top-level directory.
 
-#include <map>
-
 #include "JScheduler.h"
 #include <JANA/Engine/JScheduler.h>
 #include <JANA/Topology/JTopologyBuilder.h>
@@ -12,41 +10,68 @@
 
 JScheduler::JScheduler(std::shared_ptr<JTopologyBuilder> topology)
     : m_topology(topology)
+    , m_policy(std::make_unique<JRoundRobinPolicy>())
     {
-        m_topology_state.next_arrow_index = 0;
-
-        // Keep track of downstream arrows
-        std::map<JArrow*, size_t> arrow_map;
-        size_t i=0;
-        for (auto* arrow : topology->arrows) {
-            arrow_map[arrow] = i++;
+        // Each arrow remembers its own index, so that checking it back in doesn't require a search
+        for (size_t i=0; i<topology->arrows.size(); ++i) {
+            topology->arrows[i]->m_index = i;
         }
         m_topology_state.arrow_states = std::vector<ArrowState>(topology->arrows.size());
 
-        for (i=0; i<topology->arrows.size(); ++i) {
+        // Keep track of downstream arrows
+        for (size_t i=0; i<topology->arrows.size(); ++i) {
             auto& as = m_topology_state.arrow_states[i];
             JArrow* arrow = topology->arrows[i];
             as.arrow = arrow;
             for (JArrow* downstream : arrow->m_listeners) {
-                as.downstream_arrow_indices.push_back(arrow_map[downstream]);
+                as.downstream_arrow_indices.push_back(downstream->m_index);
             }
         }
+
+        // Anything that hands items to an arrow might give an idle worker something to do
+        for (JQueue* queue : topology->queues) {
+            queue->set_push_notifier([this]{ m_parking_lot.notify(); });
+        }
+        for (JPoolBase* pool : topology->pools) {
+            pool->set_push_notifier([this]{ m_parking_lot.notify(); });
+        }
     }
 
 
-JArrow* JScheduler::next_assignment(uint32_t worker_id, JArrow* assignment, JArrowMetrics::Status last_result) {
+JScheduler::ArrowState& JScheduler::ArrowState::operator=(const ArrowState& other) {
+    arrow = other.arrow;
+    status = other.status.load();
+    thread_count = other.thread_count.load();
+    active_or_draining_upstream_arrow_count = other.active_or_draining_upstream_arrow_count.load();
+    downstream_arrow_indices = other.downstream_arrow_indices;
+    return *this;
+}
 
-    std::lock_guard<std::mutex> lock(m_mutex);
+JScheduler::TopologyState& JScheduler::TopologyState::operator=(const TopologyState& other) {
+    arrow_states = other.arrow_states;
+    current_topology_status = other.current_topology_status;
+    active_or_draining_arrow_count = other.active_or_draining_arrow_count.load();
+    return *this;
+}
+
+
+JArrow* JScheduler::next_assignment(uint32_t worker_id, JArrow* assignment, JArrowMetrics::Status last_result,
+                                    const JArrowMetrics* latest_metrics) {
 
     LOG_DEBUG(logger) << "Worker " << worker_id << " checking in: "
                       << ((assignment == nullptr) ? "idle" : assignment->get_name()) << " -> " << to_string(last_result) << LOG_END;
 
     // Check latest arrow back in
     if (assignment != nullptr) {
-        checkin_unprotected(assignment, last_result);
+        m_policy->on_checkin(assignment, last_result, latest_metrics);
+        if (m_sticky_assignments && should_keep_assignment(assignment, last_result)) {
+            LOG_DEBUG(logger) << "Worker " << worker_id << " keeps: " << assignment->get_name() << LOG_END;
+            return assignment;
+        }
+        checkin(assignment, last_result);
     }
 
-    JArrow* next = checkout_unprotected();
+    JArrow* next = checkout_any();
 
     LOG_DEBUG(logger) << "Worker " << worker_id << " assigned: "
                       << ((next == nullptr) ? "idle" : next->get_name()) << LOG_END;
@@ -55,72 +80,138 @@ JArrow* JScheduler::next_assignment(uint32_t worker_id, JArrow* assignment, JArr
 }
 
 
-void JScheduler::last_assignment(uint32_t worker_id, JArrow* assignment, JArrowMetrics::Status last_result) {
+bool JScheduler::should_keep_assignment(JArrow* assignment, JArrowMetrics::Status last_result) {
 
-    std::lock_guard<std::mutex> lock(m_mutex);
+    // The worker still holds the arrow, so its status can only have moved away from Active via a pause or drain
+    ArrowState& as = m_topology_state.arrow_states[assignment->get_index()];
+    if (as.status != ArrowStatus::Active) return false;
+    if (last_result == JArrowMetrics::Status::Finished) return false;
+
+    if (assignment->is_source()) {
+        // Sources have no input queue, so we go by whether the last call produced anything
+        if (last_result != JArrowMetrics::Status::KeepGoing) return false;
+    }
+    else {
+        // Starved. Checking the arrow in also lets it be deactivated once its upstreams are done.
+        if (assignment->get_input_occupancy() <= 0.0) return false;
+    }
+    // Downstream congested: somebody needs to drain it, possibly us
+    return assignment->get_output_headroom() > 0.0;
+}
+
+
+void JScheduler::last_assignment(uint32_t worker_id, JArrow* assignment, JArrowMetrics::Status last_result,
+                                 const JArrowMetrics* latest_metrics) {
 
     LOG_DEBUG(logger) << "Worker " << worker_id << " checking in: "
                        << ((assignment == nullptr) ? "idle" : assignment->get_name())
                        << " -> " << to_string(last_result) << "). Shutting down!" << LOG_END;
 
     if (assignment != nullptr) {
-        checkin_unprotected(assignment, last_result);
+        m_policy->on_checkin(assignment, last_result, latest_metrics);
+        checkin(assignment, last_result);
     }
 }
 
 
+JArrowMetrics* JScheduler::get_worker_arrow_metrics(uint32_t worker_id) {
+    std::lock_guard<std::mutex> lock(m_worker_metrics_mutex);
+    while (m_worker_arrow_metrics.size() <= worker_id) {
+        m_worker_arrow_metrics.push_back(std::unique_ptr<JArrowMetrics[]>(new JArrowMetrics[m_topology->arrows.size()]));
+    }
+    return m_worker_arrow_metrics[worker_id].get();
+}
 
-void JScheduler::checkin_unprotected(JArrow* assignment, JArrowMetrics::Status last_result) {
-    // Find index of arrow
-    size_t index = 0;
-    while (m_topology_state.arrow_states[index].arrow != assignment) index++;
-    assert(index < m_topology_state.arrow_states.size());
 
-    // Decrement arrow's thread count
-    ArrowState& as = m_topology_state.arrow_states[index];
-    as.thread_count -= 1;
+void JScheduler::collect_arrow_metrics(size_t arrow_index, JArrowMetrics& result) {
+    result.clear();
+    result.update(m_topology->arrows[arrow_index]->get_metrics());
+    std::lock_guard<std::mutex> lock(m_worker_metrics_mutex);
+    for (auto& worker_metrics : m_worker_arrow_metrics) {
+        result.update(worker_metrics[arrow_index]);
+    }
+}
 
-    bool found_inactive_source = 
-        assignment->is_source() && 
-        last_result == JArrowMetrics::Status::Finished &&           // Only Sources get to declare themselves finished!
-        as.status == ArrowStatus::Active;                           // We only want to deactivate once
 
+void JScheduler::set_policy(std::unique_ptr<JSchedulingPolicy> policy) {
+    assert(policy != nullptr);
+    m_policy = std::move(policy);
+}
 
-    bool found_draining_stage_or_sink = 
-        !assignment->is_source() &&                                 // We aren't a source
-        as.active_or_draining_upstream_arrow_count == 0 &&          // All upstreams arrows are inactive
-        assignment->get_pending() == 0 &&                           // All upstream queues are empty
-        as.thread_count > 0 &&                                      // There are other workers still assigned to this arrow
-        as.status == ArrowStatus::Active;                           // We only want to deactivate once
 
+void JScheduler::checkin(JArrow* assignment, JArrowMetrics::Status last_result) {
+
+    ArrowState& as = m_topology_state.arrow_states[assignment->m_index];
+    assert(as.arrow == assignment);
 
-    bool found_inactive_stage_or_sink = 
+    // Decrement arrow's thread count. A sequential arrow is now free for somebody else to pick up.
+    as.thread_count.fetch_sub(1);
+    if (!assignment->is_parallel()) {
+        m_parking_lot.notify();
+    }
+
+    // Only take the mutex if this checkin could trigger a status transition. Everything read here
+    // is either monotonic once it reaches the state we test for, or rechecked under the mutex.
+    ArrowStatus status = as.status;
+    bool transition_possible =
+        status == ArrowStatus::Draining ||
+        (assignment->is_source() && last_result == JArrowMetrics::Status::Finished && status == ArrowStatus::Active) ||
+        (!assignment->is_source() && status == ArrowStatus::Active &&
+            as.active_or_draining_upstream_arrow_count == 0 && assignment->get_pending() == 0) ||
+        m_topology_state.active_or_draining_arrow_count == 0;
+
+    if (transition_possible) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        checkin_unprotected(assignment, last_result);
+    }
+}
+
+
+void JScheduler::checkin_unprotected(JArrow* assignment, JArrowMetrics::Status last_result) {
+
+    size_t index = assignment->m_index;
+    ArrowState& as = m_topology_state.arrow_states[index];
+    ArrowStatus status = as.status;
+
+    bool found_finished_source = 
+        assignment->is_source() && 
+        ((last_result == JArrowMetrics::Status::Finished &&         // Only Sources get to declare themselves finished!
+          status == ArrowStatus::Active) ||                         // We only want to deactivate once
+         status == ArrowStatus::Draining);                          // ...or a previous worker already did and we are the last one out
+
+    bool found_exhausted_stage_or_sink = 
         !assignment->is_source() &&                                 // We aren't a source
         as.active_or_draining_upstream_arrow_count == 0 &&          // All upstreams arrows are inactive
         assignment->get_pending() == 0 &&                           // All upstream queues are empty
-        as.thread_count == 0 &&                                     // There are NO other workers still assigned to this arrow
-        (as.status == ArrowStatus::Draining ||                      // We only want to deactivate once
-            as.status == ArrowStatus::Active);
+        (status == ArrowStatus::Draining ||                         // We only want to deactivate once
+            status == ArrowStatus::Active);
 
+    if (found_finished_source || found_exhausted_stage_or_sink) {
 
-    if (found_inactive_source || found_inactive_stage_or_sink) {
+        // Stop handing out the arrow _before_ looking at its thread count. Workers checking the arrow out
+        // increment the thread count _before_ looking at its status. So either we see their thread, or
+        // they see that the arrow is draining and hand it straight back.
+        as.status = ArrowStatus::Draining;
 
-        // Deactivate arrow
-        // Because we are deactivating it from Active state, we know the topology has not been paused. Hence we can finalize immediately.
-        assignment->finalize();
-        as.status = ArrowStatus::Finalized;
-        m_topology_state.active_or_draining_arrow_count--;
+        if (as.thread_count <= 0) {
+            // Deactivate arrow
+            // Because we are deactivating it from Active state, we know the topology has not been paused. Hence we can finalize immediately.
+            assignment->finalize();
+            as.status = ArrowStatus::Finalized;
+            m_topology_state.active_or_draining_arrow_count--;
 
-        LOG_DEBUG(logger) << "Deactivated arrow '" << assignment->get_name() << "' (" << m_topology_state.active_or_draining_arrow_count << " remaining)" << LOG_END;
+            LOG_DEBUG(logger) << "Deactivated arrow '" << assignment->get_name() << "' (" << m_topology_state.active_or_draining_arrow_count << " remaining)" << LOG_END;
 
-        for (size_t downstream: m_topology_state.arrow_states[index].downstream_arrow_indices) {
-            m_topology_state.arrow_states[downstream].active_or_draining_upstream_arrow_count--;
+            for (size_t downstream: as.downstream_arrow_indices) {
+                m_topology_state.arrow_states[downstream].active_or_draining_upstream_arrow_count--;
+            }
+            // Downstream arrows may now be ready to deactivate, which needs a worker to check them in
+            m_parking_lot.notify();
+        }
+        else if (status == ArrowStatus::Active) {
+            // There are other workers still assigned to this arrow. The last one out will finalize it.
+            LOG_DEBUG(logger) << "Draining arrow '" << assignment->get_name() << "' (" << m_topology_state.active_or_draining_arrow_count << " remaining)" << LOG_END;
         }
-    }
-    else if (found_draining_stage_or_sink) {
-        // Drain arrow
-        as.status = ArrowStatus::Draining;
-        LOG_DEBUG(logger) << "Draining arrow '" << assignment->get_name() << "' (" << m_topology_state.active_or_draining_arrow_count << " remaining)" << LOG_END;
     }
 
     // Test if this was the last arrow running
@@ -131,46 +222,63 @@ void JScheduler::checkin_unprotected(JArrow* assignment, JArrowMetrics::Status l
 }
 
 
+bool JScheduler::try_checkout(ArrowState& candidate, bool allow_inactive) {
+
+    auto is_schedulable = [&](ArrowStatus status) {
+        // This excludes Draining arrows
+        return status == ArrowStatus::Active || (allow_inactive && status == ArrowStatus::Inactive);
+    };
+
+    if (!is_schedulable(candidate.status)) return false;
+
+    if (candidate.arrow->is_parallel()) {
+        candidate.thread_count.fetch_add(1);
+    }
+    else {
+        // This excludes non-parallel arrows that are already assigned to a worker
+        int64_t expected = 0;
+        if (!candidate.thread_count.compare_exchange_strong(expected, 1)) return false;
+    }
+
+    // Recheck now that our thread is visible. See checkin_unprotected() for the other half of this handshake.
+    if (is_schedulable(candidate.status)) return true;
+
+    // We lost the race against a transition. Hand the arrow back the usual way, in case we were the last one out.
+    checkin(candidate.arrow, JArrowMetrics::Status::ComeBackLater);
+    return false;
+}
+
+
 JArrow* JScheduler::checkout(size_t arrow_index) {
-    // Note that this lets us check out Inactive arrows, whereas checkout_unprotected() does not. This because we are called by JApplicationInspector
-    // whereas checkout_unprotected is called by JWorker. This is because JArrowProcessingController::request_pause shuts off the topology
+    // Note that this lets us check out Inactive arrows, whereas checkout_any() does not. This because we are called by JApplicationInspector
+    // whereas checkout_any is called by JWorker. This is because JArrowProcessingController::request_pause shuts off the topology
     // instead of shutting off the workers, which in hindsight might have been the wrong choice.
 
-    std::lock_guard<std::mutex> lock(m_mutex);
-
     if (arrow_index >= m_topology_state.arrow_states.size()) return nullptr;
 
     ArrowState& candidate = m_topology_state.arrow_states[arrow_index];
-
-    if ((candidate.status == ArrowStatus::Active || candidate.status == ArrowStatus::Inactive) &&   // This excludes Draining arrows
-        (candidate.arrow->is_parallel() || candidate.thread_count == 0)) {      // This excludes non-parallel arrows that are already assigned to a worker
-
-        m_topology_state.arrow_states[arrow_index].thread_count += 1;
+    if (try_checkout(candidate, true)) {
         return candidate.arrow;
-
     }
     return nullptr;
 }
 
 
-JArrow* JScheduler::checkout_unprotected() {
-
-    // Choose a new arrow. Loop over all arrows, starting at where we last left off, and pick the first arrow that works
-    size_t current_idx = m_topology_state.next_arrow_index;
-    do {
-        ArrowState& candidate = m_topology_state.arrow_states[current_idx];
-        current_idx += 1;
-        current_idx %= m_topology->arrows.size();
+JArrow* JScheduler::checkout_any() {
 
-        if (candidate.status == ArrowStatus::Active &&                                // This excludes Draining arrows
-            (candidate.arrow->is_parallel() || candidate.thread_count == 0)) {      // This excludes non-parallel arrows that are already assigned to a worker
+    // Let the policy rank the arrows, and pick the first one that can take another worker
+    if (m_topology->arrows.empty()) return nullptr;
 
-                m_topology_state.next_arrow_index = current_idx; // Next time, continue right where we left off
-                candidate.thread_count += 1;
-                return candidate.arrow;
+    thread_local std::vector<size_t> ranking;
+    m_policy->rank(m_topology->arrows, ranking);
 
+    for (size_t index : ranking) {
+        ArrowState& candidate = m_topology_state.arrow_states[index];
+        if (try_checkout(candidate, false)) {
+            m_policy->on_checkout(index);
+            return candidate.arrow;
         }
-    } while (current_idx != m_topology_state.next_arrow_index);
+    }
     return nullptr;  // We've looped through everything with no luck
 }
 
@@ -207,7 +315,8 @@ void JScheduler::drain_topology() {
         }
     }
     m_topology_state.current_topology_status = TopologyStatus::Draining;
-
+    // We deliberately don't wake parked workers here, since that would mean taking a mutex inside a signal handler.
+    // They notice on their own within JWorker's checkin time.
 }
 
 void JScheduler::run_topology(int nthreads) {
@@ -241,6 +350,7 @@ void JScheduler::run_topology(int nthreads) {
     m_topology->metrics.reset();
     m_topology->metrics.start(nthreads);
     m_topology_state.current_topology_status = TopologyStatus::Running;
+    m_parking_lot.notify();
 }
 
 void JScheduler::request_topology_pause() {
@@ -255,6 +365,7 @@ void JScheduler::request_topology_pause() {
             // If arrow is not running, pause() is a no-op
         }
         m_topology_state.current_topology_status = TopologyStatus::Pausing;
+        m_parking_lot.notify();  // Parked workers need to notice that they should stop
     }
     else {
         LOG_DEBUG(logger) << "JScheduler: request_pause() : " << current_status << " => " << current_status << LOG_END;
@@ -275,6 +386,7 @@ void JScheduler::achieve_topology_pause_unprotected() {
         LOG_DEBUG(logger) << "JScheduler: achieve_topology_pause() : " << current_status << " => " << TopologyStatus::Paused << LOG_END;
         m_topology->metrics.stop();
         m_topology_state.current_topology_status = TopologyStatus::Paused;
+        m_parking_lot.notify();
     }
     else {
         LOG_DEBUG(logger) << "JScheduler: achieve_topology_pause() : " << current_status << " => " << current_status << LOG_END;
@@ -292,6 +404,7 @@ void JScheduler::finish_topology() {
         }
     }
     m_topology_state.current_topology_status = TopologyStatus::Finalized;
+    m_parking_lot.notify();
 }
 
 JScheduler::TopologyStatus JScheduler::get_topology_status() {
@@ -415,6 +528,7 @@ void JScheduler::summarize_arrows(std::vector<ArrowSummary>& summaries) {
         summary.is_sink = as.arrow->is_sink();
         summary.chunksize = as.arrow->get_chunksize();
         summary.messages_pending = as.arrow->get_pending();
+        summary.steal_count = as.arrow->get_steal_count();
         summary.threshold = as.arrow->get_threshold();
 
         summary.thread_count = as.thread_count;
@@ -430,7 +544,9 @@ void JScheduler::summarize_arrows(std::vector<ArrowSummary>& summaries) {
         JArrowMetrics::duration_t total_queue_latency;
         JArrowMetrics::duration_t last_queue_latency;
 
-        as.arrow->get_metrics().get(
+        JArrowMetrics metrics;
+        collect_arrow_metrics(i, metrics);
+        metrics.get(
             last_status, 
             total_message_count, 
             last_message_count, 
@@ -5,16 +5,21 @@
 #pragma once
 #include <mutex>
 #include <vector>
+#include <atomic>
 
 #include <JANA/Topology/JArrow.h>
 #include <JANA/Topology/JTopologyBuilder.h>
 #include <JANA/Engine/JPerfSummary.h>
+#include <JANA/Engine/JSchedulingPolicy.h>
+#include <JANA/Engine/JParkingLot.h>
+#include <JANA/Utils/JCpuInfo.h>
 
 
 struct JArrowTopology;
 
 /// Scheduler assigns Arrows to Workers in a first-come-first-serve manner,
-/// not unlike OpenMP's `schedule dynamic`.
+/// not unlike OpenMP's `schedule dynamic`. Which arrow a worker is offered first
+/// is up to the JSchedulingPolicy.
 class JScheduler {
 public:
     enum class TopologyStatus { 
@@ -33,23 +38,34 @@ public:
                              Finalized        // Arrow should not be scheduled, and has been finalized(), so it may not be re-activated
                             };
 
-    struct ArrowState {
+    /// Status and thread count are atomic so that workers can check arrows in and out without taking m_mutex.
+    /// Each ArrowState gets its own cache line, so that workers hammering different arrows don't contend.
+    /// Copying an ArrowState takes a snapshot, which is what get_topology_state() hands out.
+    struct alignas(JANA2_CACHE_LINE_BYTES) ArrowState {
         JArrow* arrow = nullptr;
-        ArrowStatus status = ArrowStatus::Uninitialized;
-        int64_t thread_count = 0;                  // Current number of threads assigned to this arrow
-        int64_t active_or_draining_upstream_arrow_count = 0;        // Current number of active or draining arrows immediately upstream
+        std::atomic<ArrowStatus> status {ArrowStatus::Uninitialized};
+        std::atomic<int64_t> thread_count {0};                                  // Current number of threads assigned to this arrow
+        std::atomic<int64_t> active_or_draining_upstream_arrow_count {0};       // Current number of active or draining arrows immediately upstream
         std::vector<size_t> downstream_arrow_indices; 
+
+        ArrowState() = default;
+        ArrowState(const ArrowState& other) { *this = other; }
+        ArrowState& operator=(const ArrowState& other);
     };
 
     struct TopologyState {
         std::vector<ArrowState> arrow_states;
         TopologyStatus current_topology_status = TopologyStatus::Uninitialized;
-        int64_t active_or_draining_arrow_count = 0;  // Detects when the topology has paused
-        size_t next_arrow_index;
+        std::atomic<int64_t> active_or_draining_arrow_count {0};  // Detects when the topology has paused
+
+        TopologyState() = default;
+        TopologyState(const TopologyState& other) { *this = other; }
+        TopologyState& operator=(const TopologyState& other);
     };
 
 private:
-    // This mutex controls ALL scheduler state
+    // This mutex controls all arrow and topology status _transitions_. Checking arrows in and out
+    // only touches the atomics in ArrowState, and only takes the mutex when a transition might be due.
     std::mutex m_mutex;
 
     std::shared_ptr<JTopologyBuilder> m_topology;
@@ -57,6 +73,20 @@ private:
     // Protected state
     TopologyState m_topology_state;
 
+    // Decides which arrow a worker gets next. Must be set before the workers start.
+    std::unique_ptr<JSchedulingPolicy> m_policy;
+
+    // Where idle workers wait. Woken by queue and pool pushes, and by arrow and topology status changes.
+    JParkingLot m_parking_lot;
+
+    // Whether workers keep their assignment for as long as it can make progress. See next_assignment().
+    bool m_sticky_assignments = false;
+
+    // Per-worker arrow metrics, indexed by worker id. See get_worker_arrow_metrics(). The mutex only
+    // protects the outer vector, so that blocks can be added while somebody is collecting.
+    std::mutex m_worker_metrics_mutex;
+    std::vector<std::unique_ptr<JArrowMetrics[]>> m_worker_arrow_metrics;
+
 
 public:
 
@@ -68,18 +98,44 @@ public:
     
     /// Lets a Worker ask the Scheduler for another assignment. If no assignments make sense,
     /// Scheduler returns nullptr, which tells that Worker to idle until his next checkin.
-    /// If next_assignment() makes any changes to internal Scheduler state or to any of its arrows,
-    /// it must be synchronized.
-    JArrow* next_assignment(uint32_t worker_id, JArrow* assignment, JArrowMetrics::Status result);
+    /// The common case is wait-free apart from CAS retries; only arrow and topology status transitions
+    /// take the scheduler mutex. `latest_metrics`, if provided, holds what the worker got done during
+    /// this assignment, and is passed on to the scheduling policy.
+    JArrow* next_assignment(uint32_t worker_id, JArrow* assignment, JArrowMetrics::Status result,
+                            const JArrowMetrics* latest_metrics = nullptr);
 
     /// Lets a Worker tell the scheduler that he is shutting down and won't be working on his assignment
     /// any more. The scheduler is thus free to reassign the arrow to one of the remaining workers.
-    void last_assignment(uint32_t worker_id, JArrow* assignment, JArrowMetrics::Status result);
+    void last_assignment(uint32_t worker_id, JArrow* assignment, JArrowMetrics::Status result,
+                         const JArrowMetrics* latest_metrics = nullptr);
+
+    /// Returns the per-arrow metrics, indexed by arrow index, that the worker with this id accumulates into.
+    /// The block belongs to the worker id rather than to a JWorker object, so a worker that gets retired and
+    /// replaced keeps adding to the same counts. Only one JWorker with a given id may run at a time.
+    JArrowMetrics* get_worker_arrow_metrics(uint32_t worker_id);
+
+    /// Sums up the metrics for one arrow across all workers, plus anything recorded directly on the arrow.
+    /// This is lazy: workers never touch shared metrics, so the cost is paid only when somebody measures.
+    void collect_arrow_metrics(size_t arrow_index, JArrowMetrics& result);
 
     /// Lets a Worker, test case, or user request a specific arrow. Returns nullptr if arrow can not be 
     /// checked up because it's no longer active or because it's already at its max parallelism.
     JArrow* checkout(size_t arrow_index);
 
+    /// Replaces the scheduling policy. Defaults to JRoundRobinPolicy; JArrowProcessingController
+    /// installs whatever `jana:scheduler_policy` asks for. Must not be called while workers are running.
+    void set_policy(std::unique_ptr<JSchedulingPolicy> policy);
+    JSchedulingPolicy* get_policy() { return m_policy.get(); }
+
+    /// Idle workers wait here instead of sleeping or exiting. See JWorker::loop()
+    JParkingLot& get_parking_lot() { return m_parking_lot; }
+
+    /// When enabled, next_assignment() hands a worker back the arrow it already has, without checking it in, for as
+    /// long as that arrow still has input and its output queues aren't full. This keeps the arrow's code and factory
+    /// state warm in the worker's caches. Set via `jana:sticky_assignments`.
+    void set_sticky_assignments(bool sticky) { m_sticky_assignments = sticky; }
+    bool get_sticky_assignments() const { return m_sticky_assignments; }
+
     /// Logger is public so that somebody else can configure it
     JLogger logger;
 
@@ -101,8 +157,11 @@ private:
     void run_arrow_unprotected(size_t index);
     void pause_arrow_unprotected(size_t index);
     void finish_arrow_unprotected(size_t index);
+    void checkin(JArrow* arrow, JArrowMetrics::Status last_result);
     void checkin_unprotected(JArrow* arrow, JArrowMetrics::Status last_result);
-    JArrow* checkout_unprotected();
+    JArrow* checkout_any();
+    bool try_checkout(ArrowState& candidate, bool allow_inactive);
+    bool should_keep_assignment(JArrow* assignment, JArrowMetrics::Status last_result);
 
 };
 
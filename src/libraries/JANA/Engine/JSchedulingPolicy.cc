@@ -0,0 +1,87 @@
+// Copyright 2024, Jefferson Science Associates, LLC.
+// Subject to the terms in the LICENSE file found in the top-level directory.
+
+#include "JSchedulingPolicy.h"
+#include <JANA/JException.h>
+
+#include <algorithm>
+
+
+std::unique_ptr<JSchedulingPolicy> JSchedulingPolicy::create(const std::string& name, size_t arrow_count) {
+    if (name == "backpressure") {
+        return std::make_unique<JBackpressurePolicy>(arrow_count);
+    }
+    if (name == "round_robin") {
+        return std::make_unique<JRoundRobinPolicy>();
+    }
+    throw JException("Unknown scheduler policy '%s'. Valid options are 'backpressure' and 'round_robin'.", name.c_str());
+}
+
+
+void JRoundRobinPolicy::rank(const std::vector<JArrow*>& arrows, std::vector<size_t>& ranking) {
+    size_t arrow_count = arrows.size();
+    size_t start_idx = m_next_arrow_index.load(std::memory_order_relaxed);
+    ranking.resize(arrow_count);
+    for (size_t i=0; i<arrow_count; ++i) {
+        ranking[i] = (start_idx + i) % arrow_count;
+    }
+}
+
+void JRoundRobinPolicy::on_checkout(size_t arrow_index) {
+    // Next time, continue right where we left off. Concurrent workers may start from the same index;
+    // that only costs fairness, never correctness.
+    m_next_arrow_index.store(arrow_index + 1, std::memory_order_relaxed);
+}
+
+
+JBackpressurePolicy::JBackpressurePolicy(size_t arrow_count)
+    : m_stats(new ArrowStats[arrow_count])
+    , m_arrow_count(arrow_count) {
+}
+
+double JBackpressurePolicy::get_score(JArrow* arrow) {
+    // Having any input at all matters far more than how much of it there is
+    double input = 1.0;
+    if (!arrow->is_source()) {
+        input = (arrow->get_pending() == 0) ? 0.0 : 0.5 + 0.5 * arrow->get_input_occupancy();
+    }
+    // Keep a small floor, so that an arrow that has been failing can still win against an arrow that can't run at all
+    double success = (1.0 + 15.0 * get_success_rate(arrow->get_index())) / 16.0;
+    return input * arrow->get_output_headroom() * success;
+}
+
+void JBackpressurePolicy::rank(const std::vector<JArrow*>& arrows, std::vector<size_t>& ranking) {
+    size_t arrow_count = arrows.size();
+    size_t start_idx = m_next_arrow_index.load(std::memory_order_relaxed);
+
+    thread_local std::vector<double> scores;
+    scores.resize(arrow_count);
+    ranking.resize(arrow_count);
+    for (size_t i=0; i<arrow_count; ++i) {
+        ranking[i] = (start_idx + i) % arrow_count;
+        scores[i] = get_score(arrows[i]);
+    }
+    std::stable_sort(ranking.begin(), ranking.end(), [&](size_t a, size_t b) { return scores[a] > scores[b]; });
+}
+
+void JBackpressurePolicy::on_checkout(size_t arrow_index) {
+    m_next_arrow_index.store(arrow_index + 1, std::memory_order_relaxed);
+}
+
+void JBackpressurePolicy::on_checkin(JArrow* arrow, JArrowMetrics::Status /*last_result*/, const JArrowMetrics* latest_metrics) {
+    size_t arrow_index = arrow->get_index();
+    if (arrow_index >= m_arrow_count || latest_metrics == nullptr) return;
+    auto& stats = m_stats[arrow_index];
+
+    // Look at how much the worker got done during this assignment
+    size_t message_count = latest_metrics->get_total_message_count();
+    size_t queue_visits = latest_metrics->get_total_queue_visits();
+    if (queue_visits == 0) return;  // Never executed
+
+    double outcome = std::min(1.0, static_cast<double>(message_count) / queue_visits);
+
+    // Exponential moving average with weight 1/8. Concurrent updates may occasionally drop a sample, which is fine.
+    auto& rate = stats.success_rate;
+    double old_rate = rate.load(std::memory_order_relaxed);
+    rate.store(old_rate + (outcome - old_rate) / 8.0, std::memory_order_relaxed);
+}
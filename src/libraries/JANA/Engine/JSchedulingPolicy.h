@@ -0,0 +1,81 @@
+// Copyright 2024, Jefferson Science Associates, LLC.
+// Subject to the terms in the LICENSE file found in the top-level directory.
+
+#pragma once
+#include <JANA/Topology/JArrow.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+/// JSchedulingPolicy decides in which order JScheduler offers arrows to a worker looking for an assignment.
+/// The scheduler still owns arrow status and thread counts: it walks the ranking and hands out the first
+/// arrow that is Active and not already at its max parallelism. Policies are called concurrently by every
+/// worker and must not block.
+class JSchedulingPolicy {
+public:
+    virtual ~JSchedulingPolicy() = default;
+
+    /// Fills `ranking` with every arrow index, most promising first. `ranking` is owned by the calling worker
+    /// and may be reused across calls.
+    virtual void rank(const std::vector<JArrow*>& arrows, std::vector<size_t>& ranking) = 0;
+
+    /// Called after the scheduler checked out the arrow at `arrow_index`
+    virtual void on_checkout(size_t /*arrow_index*/) {}
+
+    /// Called whenever a worker hands an arrow back. `latest_metrics` holds what that worker got done during the
+    /// assignment, or is null if the caller doesn't know.
+    virtual void on_checkin(JArrow* /*arrow*/, JArrowMetrics::Status /*last_result*/, const JArrowMetrics* /*latest_metrics*/) {}
+
+    /// Creates the policy named by `jana:scheduler_policy`. Throws JException for unknown names.
+    static std::unique_ptr<JSchedulingPolicy> create(const std::string& name, size_t arrow_count);
+};
+
+
+/// Hands out arrows in round-robin order, continuing after the last arrow that was checked out,
+/// regardless of queue occupancy. This is JANA's original behavior.
+class JRoundRobinPolicy : public JSchedulingPolicy {
+    std::atomic<size_t> m_next_arrow_index {0};
+
+public:
+    void rank(const std::vector<JArrow*>& arrows, std::vector<size_t>& ranking) override;
+    void on_checkout(size_t arrow_index) override;
+};
+
+
+/// Ranks arrows by how likely they are to make progress right now, so that workers don't waste a
+/// ComeBackLater round trip (and the backoff that follows) on a source whose output queue is full, or
+/// on a stage whose input queue is empty. The score of an arrow is
+///
+///     input * output_headroom * (1 + 15 * success_rate) / 16
+///
+/// where input is 0 for an empty input queue, and between 0.5 and 1 depending on occupancy otherwise
+/// (sources always have input). success_rate is a moving average, over recent assignments, of messages
+/// completed per execute() according to the checking-in worker's JArrowMetrics. We don't use the returned status here, because
+/// a chunked arrow reports ComeBackLater whenever it runs dry, even if it did useful work first. A source
+/// that keeps finding its pool empty thus yields to any stage with input.
+/// Arrows that score zero are still offered, just last, so that they can be checked in and deactivated.
+/// Ties keep round-robin order, so that equally good parallel arrows share the workers.
+class JBackpressurePolicy : public JSchedulingPolicy {
+
+    struct alignas(JANA2_CACHE_LINE_BYTES) ArrowStats {
+        std::atomic<double> success_rate {1.0};
+    };
+
+    std::unique_ptr<ArrowStats[]> m_stats;
+    size_t m_arrow_count;
+    std::atomic<size_t> m_next_arrow_index {0};
+
+public:
+    explicit JBackpressurePolicy(size_t arrow_count);
+
+    void rank(const std::vector<JArrow*>& arrows, std::vector<size_t>& ranking) override;
+    void on_checkout(size_t arrow_index) override;
+    void on_checkin(JArrow* arrow, JArrowMetrics::Status last_result, const JArrowMetrics* latest_metrics) override;
+
+    double get_score(JArrow* arrow);
+    double get_success_rate(size_t arrow_index) const { return m_stats[arrow_index].success_rate.load(std::memory_order_relaxed); }
+};
+
@@ -22,34 +22,22 @@ void JWorker::declare_timeout() {
 }
 
 void JWorker::measure_perf(WorkerSummary& summary) {
-    // Read (do not clear) worker metrics
-    // Read and clear arrow metrics
-    // Push arrow metrics upstream
+    // This only ever reads our metrics, so it doesn't need to coordinate with loop().
+    // The arrow metrics are this worker's totals for its current arrow; JScheduler::collect_arrow_metrics()
+    // does the aggregation across workers.
 
     JArrowMetrics latest_arrow_metrics;
-    latest_arrow_metrics.clear();
-    latest_arrow_metrics.take(m_arrow_metrics); // move local arrow metrics onto stack
     std::string arrow_name = "idle";
     {
         std::lock_guard<std::mutex> lock(m_assignment_mutex);
         if (m_assignment != nullptr) {
-            m_assignment->get_metrics().update(latest_arrow_metrics); // propagate to global arrow context
+            latest_arrow_metrics.update(m_arrow_totals[m_assignment->get_index()]);
             arrow_name = m_assignment->get_name();
         }
     }
     // Unpack latest_arrow_metrics, add to WorkerSummary
 
-    // If we wanted to average over our measurement interval only, we would also do:
-    // From inside JProcessingController, do _after_ JWorker::measure_perf() for all workers:
-    // for all arrows:
-    //     arrow->overall_metrics.take(arrow->interval_metrics);
-
-    // From right here, at the very end:
-    //     worker->overall_metrics.take(worker->interval_metrics);
-
-    JWorkerMetrics latest_worker_metrics;
-    latest_worker_metrics.clear();
-    latest_worker_metrics.update(m_worker_metrics); // nondestructive
+    const JWorkerMetrics& latest_worker_metrics = m_worker_metrics;
     // Unpack latest_worker_metrics, add to WorkerSummary
 
     using millis = std::chrono::duration<double, std::milli>;
@@ -76,6 +64,7 @@ void JWorker::measure_perf(WorkerSummary& summary) {
     summary.cpu_id = m_cpu_id;
     summary.is_pinned = m_pin_to_cpu;
     summary.scheduler_visit_count = scheduler_visit_count;
+    summary.migration_count = m_migration_count.load(std::memory_order_relaxed);
 
     summary.last_arrow_name = arrow_name;
 
@@ -119,6 +108,7 @@ JWorker::JWorker(JArrowProcessingController* japc, JScheduler* scheduler, unsign
         m_thread(nullptr) {
 
     m_arrow_metrics.clear();
+    m_arrow_totals = scheduler->get_worker_arrow_metrics(worker_id);
     m_worker_metrics.clear();
 }
 
@@ -142,6 +132,7 @@ void JWorker::start() {
 void JWorker::request_stop() {
     if (m_run_state == RunState::Running) {
         m_run_state = RunState::Stopping;
+        m_scheduler->get_parking_lot().notify();  // In case this worker is parked
     }
 }
 
@@ -174,6 +165,9 @@ void JWorker::loop() {
     try {
         LOG_DEBUG(logger) << "Worker " << m_worker_id << " has entered loop()." << LOG_END;
         JArrowMetrics::Status last_result = JArrowMetrics::Status::NotRunYet;
+        auto& parking_lot = m_scheduler->get_parking_lot();
+        bool is_waiting = false;     // Whether this worker is registered with the parking lot
+        uint64_t seen_epoch = 0;
 
         while (m_run_state == RunState::Running) {
 
@@ -181,9 +175,14 @@ void JWorker::loop() {
 
             {
                 std::lock_guard<std::mutex> lock(m_assignment_mutex);
-                m_assignment = m_scheduler->next_assignment(m_worker_id, m_assignment, last_result);
+                JArrow* previous_assignment = m_assignment;
+                m_assignment = m_scheduler->next_assignment(m_worker_id, m_assignment, last_result, &m_arrow_metrics);
+                if (previous_assignment != nullptr && m_assignment != nullptr && m_assignment != previous_assignment) {
+                    m_migration_count.fetch_add(1, std::memory_order_relaxed);
+                }
             }
             last_result = JArrowMetrics::Status::NotRunYet;
+            m_arrow_metrics.clear();
 
             auto scheduler_time = jclock_t::now();
 
@@ -193,18 +192,38 @@ void JWorker::loop() {
             auto useful_duration = jclock_t::duration::zero();
 
             if (m_assignment == nullptr) {
-                LOG_DEBUG(logger) << "Worker " << m_worker_id << " shutdown driven by topology pause" << LOG_END;
-                m_run_state = RunState::Stopped;
-                return;
-
-                // LOG_DEBUG(logger) << "Worker " << m_worker_id << " idling due to lack of assignments" << LOG_END;
-                // std::this_thread::sleep_for(std::chrono::microseconds(1));
-                // idle_duration = jclock_t::now() - scheduler_time;
+                auto topology_status = m_scheduler->get_topology_status();
+                if (topology_status != JScheduler::TopologyStatus::Running &&
+                    topology_status != JScheduler::TopologyStatus::Draining) {
+
+                    if (is_waiting) parking_lot.end_waiting();
+                    LOG_DEBUG(logger) << "Worker " << m_worker_id << " shutdown driven by topology pause" << LOG_END;
+                    m_run_state = RunState::Stopped;
+                    return;
+                }
+                if (!is_waiting) {
+                    // Register first and then look for work once more, so that we can't miss a notify()
+                    parking_lot.begin_waiting();
+                    is_waiting = true;
+                    seen_epoch = parking_lot.get_epoch();
+                }
+                else {
+                    LOG_TRACE(logger) << "Worker " << m_worker_id << " parking due to lack of assignments" << LOG_END;
+                    parking_lot.wait(seen_epoch, m_spin_budget, m_checkin_time);
+                    seen_epoch = parking_lot.get_epoch();
+                    idle_duration = jclock_t::now() - scheduler_time;
+                }
             }
             else {
+                if (is_waiting) {
+                    parking_lot.end_waiting();
+                    is_waiting = false;
+                }
 
                 uint32_t current_tries = 0;
                 auto backoff_duration = m_initial_backoff_time;
+                bool is_backing_off = false;  // Whether this worker is registered with the parking lot
+                uint64_t backoff_epoch = 0;
 
                 while (current_tries <= m_backoff_tries &&
                        (last_result == JArrowMetrics::Status::KeepGoing || last_result == JArrowMetrics::Status::ComeBackLater || last_result == JArrowMetrics::Status::NotRunYet) &&
@@ -238,22 +257,33 @@ void JWorker::loop() {
                                               << m_assignment->get_name() << ", tries = " << current_tries
                                               << LOG_END;
 
-                            std::this_thread::sleep_for(backoff_duration);
-                            retry_duration += backoff_duration;
+                            // Rather than sleeping for the full backoff, wait until something gets pushed. The first
+                            // failure only registers with the parking lot, so that the retry can't miss a notify().
+                            if (!is_backing_off) {
+                                parking_lot.begin_waiting();
+                                is_backing_off = true;
+                            }
+                            else {
+                                auto before_wait_time = jclock_t::now();
+                                parking_lot.wait(backoff_epoch, m_spin_budget, backoff_duration);
+                                retry_duration += (jclock_t::now() - before_wait_time);
+                            }
+                            backoff_epoch = parking_lot.get_epoch();
                         }
                     }
                 }
+                if (is_backing_off) {
+                    parking_lot.end_waiting();
+                }
             }
             m_worker_metrics.update(start_time, 1, useful_duration, retry_duration, scheduler_duration, idle_duration);
             if (m_assignment != nullptr) {
-                JArrowMetrics latest_arrow_metrics;
-                latest_arrow_metrics.clear();
-                latest_arrow_metrics.take(m_arrow_metrics); // move local arrow metrics onto stack
-                m_assignment->get_metrics().update(latest_arrow_metrics); // propagate to global arrow context
+                m_arrow_totals[m_assignment->get_index()].update(m_arrow_metrics);
             }
         }
 
-        m_scheduler->last_assignment(m_worker_id, m_assignment, last_result);
+        if (is_waiting) parking_lot.end_waiting();
+        m_scheduler->last_assignment(m_worker_id, m_assignment, last_result, &m_arrow_metrics);
         m_assignment = nullptr; // Worker has 'handed in' the assignment
         LOG_DEBUG(logger) << "Worker " << m_worker_id << " shutdown due to worker->request_stop()." << LOG_END;
     }
@@ -42,14 +42,17 @@ private:
     JArrow* m_assignment;
     std::thread* m_thread;    // JWorker encapsulates a thread of some kind. Nothing else should care how.
     JWorkerMetrics m_worker_metrics;
-    JArrowMetrics m_arrow_metrics;
+    JArrowMetrics m_arrow_metrics;        // What we got done during the current assignment
+    JArrowMetrics* m_arrow_totals;        // Everything we got done, per arrow. Owned by JScheduler, written only by us
     std::mutex m_assignment_mutex;
     JException m_exception;
+    std::atomic<size_t> m_migration_count {0};  // How often the scheduler moved us from one arrow to another
 
     BackoffStrategy m_backoff_strategy = BackoffStrategy::Exponential;
     duration_t m_initial_backoff_time = std::chrono::microseconds(1);
     duration_t m_checkin_time = std::chrono::milliseconds(500);
     unsigned m_backoff_tries = 4;
+    size_t m_spin_budget = JParkingLot::MIN_SPIN_COUNT;  // Adapted by JParkingLot::wait()
 
 public:
     JWorker(JArrowProcessingController* japc, JScheduler* scheduler, unsigned worker_id, unsigned cpu_id, unsigned domain_id, bool pin_to_cpu);
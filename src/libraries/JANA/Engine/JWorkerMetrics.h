@@ -1,18 +1,19 @@
-
 // Copyright 2020, Jefferson Science Associates, LLC.
 // Subject to the terms in the LICENSE file found in the top-level directory.
 
 #pragma once
+#include <JANA/Utils/JCpuInfo.h>
+#include <atomic>
 #include <chrono>
-#include <mutex>
 
-class JWorkerMetrics {
+class alignas(JANA2_CACHE_LINE_BYTES) JWorkerMetrics {
     /// Workers need to maintain metrics. Similar to Arrow::Metrics, these form a monoid
-    /// where the identity element is (0,0,0) and the combine operation accumulates totals
-    /// in a thread-safe way. Alas, the combine operation mutates state for performance reasons.
+    /// where the identity element is (0,0,0) and the combine operation accumulates totals.
     /// We've separated Metrics from the Worker itself because it is not always obvious
     /// who should be performing the accumulation or when, and this gives us the freedom to
     /// try different possibilities.
+    /// Like JArrowMetrics, each instance has a single writer (its JWorker) and is read without
+    /// locking by whoever is measuring performance.
 
 public:
     using clock_t = std::chrono::steady_clock;
@@ -20,75 +21,66 @@ public:
     using time_point_t = clock_t::time_point;
 
 private:
-    mutable std::mutex m_mutex;
-    // mutex is mutable so that we can lock before reading from a const ref
+    std::atomic<time_point_t> m_last_heartbeat {clock_t::now()};
+    std::atomic<long> m_scheduler_visit_count {0};
+
+    std::atomic<duration_t> m_total_useful_time {duration_t::zero()};
+    std::atomic<duration_t> m_total_retry_time {duration_t::zero()};
+    std::atomic<duration_t> m_total_scheduler_time {duration_t::zero()};
+    std::atomic<duration_t> m_total_idle_time {duration_t::zero()};
+    std::atomic<duration_t> m_last_useful_time {duration_t::zero()};
+    std::atomic<duration_t> m_last_retry_time {duration_t::zero()};
+    std::atomic<duration_t> m_last_scheduler_time {duration_t::zero()};
+    std::atomic<duration_t> m_last_idle_time {duration_t::zero()};
+
+    template <typename T>
+    static T load(const std::atomic<T>& field) { return field.load(std::memory_order_relaxed); }
 
-    time_point_t m_last_heartbeat;
-    long m_scheduler_visit_count;
+    template <typename T>
+    static void store(std::atomic<T>& field, T value) { field.store(value, std::memory_order_relaxed); }
 
-    duration_t m_total_useful_time;
-    duration_t m_total_retry_time;
-    duration_t m_total_scheduler_time;
-    duration_t m_total_idle_time;
-    duration_t m_last_useful_time;
-    duration_t m_last_retry_time;
-    duration_t m_last_scheduler_time;
-    duration_t m_last_idle_time;
+    template <typename T>
+    static void add(std::atomic<T>& field, T delta) { field.store(field.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed); }
 
 
 public:
-    JWorkerMetrics() {
-        m_mutex.lock();
-        m_last_heartbeat = clock_t::now();
-        m_scheduler_visit_count = 0;
-        auto zero = duration_t::zero();
-        m_total_useful_time = zero;
-        m_total_retry_time = zero;
-        m_total_scheduler_time = zero;
-        m_total_idle_time = zero;
-        m_last_useful_time = zero;
-        m_last_retry_time = zero;
-        m_last_scheduler_time = zero;
-        m_last_idle_time = zero;
-        m_mutex.unlock();
-    }
+    JWorkerMetrics() = default;
+    JWorkerMetrics(const JWorkerMetrics&) = delete;
+    JWorkerMetrics& operator=(const JWorkerMetrics&) = delete;
 
+    /// Writer only
     void clear() {
-        m_mutex.lock();
-        m_last_heartbeat = clock_t::now();
-        m_scheduler_visit_count = 0;
         auto zero = duration_t::zero();
-        m_total_useful_time = zero;
-        m_total_retry_time = zero;
-        m_total_scheduler_time = zero;
-        m_total_idle_time = zero;
-        m_last_useful_time = zero;
-        m_last_retry_time = zero;
-        m_last_scheduler_time = zero;
-        m_last_idle_time = zero;
-        m_mutex.unlock();
+        store(m_last_heartbeat, clock_t::now());
+        store(m_scheduler_visit_count, 0L);
+        store(m_total_useful_time, zero);
+        store(m_total_retry_time, zero);
+        store(m_total_scheduler_time, zero);
+        store(m_total_idle_time, zero);
+        store(m_last_useful_time, zero);
+        store(m_last_retry_time, zero);
+        store(m_last_scheduler_time, zero);
+        store(m_last_idle_time, zero);
     }
 
 
+    /// Writer only. Accumulates `other` into this, leaving `other` untouched.
     void update(const JWorkerMetrics &other) {
 
-        m_mutex.lock();
-        other.m_mutex.lock();
-        m_last_heartbeat = other.m_last_heartbeat;
-        m_scheduler_visit_count += other.m_scheduler_visit_count;
-        m_total_useful_time += other.m_total_useful_time;
-        m_total_retry_time += other.m_total_retry_time;
-        m_total_scheduler_time += other.m_total_scheduler_time;
-        m_total_idle_time += other.m_total_idle_time;
-        m_last_useful_time = other.m_last_useful_time;
-        m_last_retry_time = other.m_last_retry_time;
-        m_last_scheduler_time = other.m_last_scheduler_time;
-        m_last_idle_time = other.m_last_idle_time;
-        other.m_mutex.unlock();
-        m_mutex.unlock();
+        store(m_last_heartbeat, load(other.m_last_heartbeat));
+        add(m_scheduler_visit_count, load(other.m_scheduler_visit_count));
+        add(m_total_useful_time, load(other.m_total_useful_time));
+        add(m_total_retry_time, load(other.m_total_retry_time));
+        add(m_total_scheduler_time, load(other.m_total_scheduler_time));
+        add(m_total_idle_time, load(other.m_total_idle_time));
+        store(m_last_useful_time, load(other.m_last_useful_time));
+        store(m_last_retry_time, load(other.m_last_retry_time));
+        store(m_last_scheduler_time, load(other.m_last_scheduler_time));
+        store(m_last_idle_time, load(other.m_last_idle_time));
     }
 
 
+    /// Writer only
     void update(
                 const time_point_t& heartbeat,
                 const long& scheduler_visit_count,
@@ -97,18 +89,16 @@ public:
                 const duration_t& scheduler_time,
                 const duration_t& idle_time) {
 
-        m_mutex.lock();
-        m_scheduler_visit_count += scheduler_visit_count;
-        m_total_useful_time += useful_time;
-        m_total_retry_time += retry_time;
-        m_total_scheduler_time += scheduler_time;
-        m_total_idle_time += idle_time;
-        m_last_useful_time = useful_time;
-        m_last_retry_time = retry_time;
-        m_last_scheduler_time = scheduler_time;
-        m_last_idle_time = idle_time;
-        m_last_heartbeat = heartbeat;
-        m_mutex.unlock();
+        add(m_scheduler_visit_count, scheduler_visit_count);
+        add(m_total_useful_time, useful_time);
+        add(m_total_retry_time, retry_time);
+        add(m_total_scheduler_time, scheduler_time);
+        add(m_total_idle_time, idle_time);
+        store(m_last_useful_time, useful_time);
+        store(m_last_retry_time, retry_time);
+        store(m_last_scheduler_time, scheduler_time);
+        store(m_last_idle_time, idle_time);
+        store(m_last_heartbeat, heartbeat);
     }
 
 
@@ -122,20 +112,18 @@ public:
              duration_t& last_useful_time,
              duration_t& last_retry_time,
              duration_t& last_scheduler_time,
-             duration_t& last_idle_time) {
-
-        m_mutex.lock();
-        scheduler_visit_count = m_scheduler_visit_count;
-        total_useful_time = m_total_useful_time;
-        total_retry_time = m_total_retry_time;
-        total_scheduler_time = m_total_scheduler_time;
-        total_idle_time = m_total_idle_time;
-        last_useful_time = m_last_useful_time;
-        last_retry_time = m_last_retry_time;
-        last_scheduler_time = m_last_scheduler_time;
-        last_idle_time = m_last_idle_time;
-        last_heartbeat = m_last_heartbeat;
-        m_mutex.unlock();
+             duration_t& last_idle_time) const {
+
+        scheduler_visit_count = load(m_scheduler_visit_count);
+        total_useful_time = load(m_total_useful_time);
+        total_retry_time = load(m_total_retry_time);
+        total_scheduler_time = load(m_total_scheduler_time);
+        total_idle_time = load(m_total_idle_time);
+        last_useful_time = load(m_last_useful_time);
+        last_retry_time = load(m_last_retry_time);
+        last_scheduler_time = load(m_last_scheduler_time);
+        last_idle_time = load(m_last_idle_time);
+        last_heartbeat = load(m_last_heartbeat);
     }
 
 };
@@ -15,6 +15,7 @@
 #include <JANA/Services/JLoggingService.h>
 #include <JANA/Services/JGlobalRootLock.h>
 #include <JANA/Engine/JArrowProcessingController.h>
+#include <JANA/Engine/JAutoscaler.h>
 #include <JANA/Utils/JApplicationInspector.h>
 
 #include <sstream>
@@ -149,6 +150,8 @@ void JApplication::Initialize() {
     ProvideService(std::make_shared<JArrowProcessingController>());
     m_processing_controller = m_service_locator->get<JArrowProcessingController>();  // Get deps from SL
     m_processing_controller->initialize();
+    ProvideService(std::make_shared<JAutoscaler>());
+    m_autoscaler = m_service_locator->get<JAutoscaler>();
 
     m_initialized = true;
     // This needs to be at the end so that m_initialized==false while InitPlugin() is being called
@@ -226,6 +229,9 @@ void JApplication::Run(bool wait_until_finished) {
         // Print status
         if( m_ticker_on ) PrintStatus();
 
+        // Adjust the number of threads, if jana:autoscale is enabled
+        m_autoscaler->tick();
+
         // Test for timeout
         if(m_timeout_on && m_processing_controller->is_timed_out()) {
             LOG_FATAL(m_logger) << "Detected timeout in worker! Stopping." << LOG_END;
@@ -18,6 +18,7 @@ class JFactorySet;
 class JComponentManager;
 class JPluginLoader;
 class JArrowProcessingController;
+class JAutoscaler;
 class JEventUnfolder;
 class JServiceLocator;
 class JParameter;
@@ -144,6 +145,7 @@ private:
     std::shared_ptr<JPluginLoader> m_plugin_loader;
     std::shared_ptr<JComponentManager> m_component_manager;
     std::shared_ptr<JArrowProcessingController> m_processing_controller;
+    std::shared_ptr<JAutoscaler> m_autoscaler;
 
     bool m_inspecting = false;
     bool m_quitting = false;
@@ -115,6 +115,11 @@ class JEvent : public std::enable_shared_from_this<JEvent>
         void SetDefaultTags(std::map<std::string, std::string> aDefaultTags){mDefaultTags=aDefaultTags; mUseDefaultTags = !mDefaultTags.empty();}
         void SetSequential(bool isSequential) {mIsBarrierEvent = isSequential;}
 
+        /// Keeps `resource` alive until the JEventPool recycles this event, after all of its factories have been
+        /// cleared. Meant for data inserted with NOT_OBJECT_OWNER, which would otherwise have no owner. Like the other
+        /// setters, this isn't synchronized, so call it from JEventSource::Emit(), not from factories.
+        void KeepAlive(std::shared_ptr<const void> resource) { mKeepAlive.push_back(std::move(resource)); }
+
         //GETTERS
         int32_t GetRunNumber() const {return mRunNumber;}
         uint64_t GetEventNumber() const {return mEventNumber;}
@@ -130,7 +135,7 @@ class JEvent : public std::enable_shared_from_this<JEvent>
         // Hierarchical
         JEventLevel GetLevel() const { return mFactorySet->GetLevel(); }
         void SetLevel(JEventLevel level) { mFactorySet->SetLevel(level); }
-        void SetEventIndex(int event_index) { mEventIndex = event_index; }
+        void SetEventIndex(int64_t event_index) { mEventIndex = event_index; }
         int64_t GetEventIndex() const { return mEventIndex; }
 
         bool HasParent(JEventLevel level) const {
@@ -192,6 +197,14 @@ class JEvent : public std::enable_shared_from_this<JEvent>
             mReferenceCount = 1;
         }
 
+        /// Clears every collection inserted into or computed for this event, along with anything it was keeping alive,
+        /// so that the event can be filled again. JEventPool does this when recycling; JEventSource does it when it
+        /// reuses an event that it decided not to emit, e.g. because of nskip.
+        void ClearData() {
+            mFactorySet->Release();
+            mKeepAlive.clear();
+        }
+
 
     private:
         JApplication* mApplication = nullptr;
@@ -204,6 +217,7 @@ class JEvent : public std::enable_shared_from_this<JEvent>
         std::map<std::string, std::string> mDefaultTags;
         JEventSource* mEventSource = nullptr;
         bool mIsBarrierEvent = false;
+        std::vector<std::shared_ptr<const void>> mKeepAlive;
 
         // Hierarchical stuff
         std::vector<std::pair<JEventLevel, std::shared_ptr<JEvent>*>> mParents;
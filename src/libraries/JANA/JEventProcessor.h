@@ -45,7 +45,10 @@ public:
     }
 
 
-    virtual void DoMap(const std::shared_ptr<const JEvent>& e) {
+    /// Prefetches every declared input. This is the part of DoMap() that is safe to run in parallel,
+    /// so it never takes the processor's lock. JTopologyBuilder runs it in a parallel arrow and calls
+    /// DoReduce() from a separate sequential arrow.
+    virtual void DoPrefetch(const std::shared_ptr<const JEvent>& e) {
 
         for (auto* input : m_inputs) {
             input->PrefetchCollection(*e);
@@ -55,7 +58,12 @@ public:
         
         // Also we don't have 
         // a Preprocess(), so we don't technically need Init() here even
-        
+    }
+
+
+    virtual void DoMap(const std::shared_ptr<const JEvent>& e) {
+
+        DoPrefetch(e);
         if (m_callback_style != CallbackStyle::DeclarativeMode) {
             DoReduce(e); // This does all the locking!
         }
@@ -167,11 +175,14 @@ protected:
     // void SetResourceName(std::string resource_name) { m_resource_name = std::move(resource_name); }
 
     /// SetEventsOrdered allows the user to tell the parallelization engine that it needs to see
-    /// the event stream ordered by increasing event IDs. (Note that this requires all EventSources
-    /// emit event IDs which are consecutive.) Ordering by event ID makes for cleaner output, but comes
-    /// with a performance penalty, so it is best if this is enabled during debugging, and disabled otherwise.
-
-    // void SetEventsOrdered(bool receive_events_in_order) { m_receive_events_in_order = receive_events_in_order; }
+    /// the event stream in the order that each JEventSource emitted it, i.e. by increasing JEvent::GetEventIndex().
+    /// Events from different sources are not ordered relative to one another. The engine puts a bounded reorder
+    /// buffer (JEventReorderArrow) in front of this processor, which costs some latency and lets a slow event
+    /// stall the whole stream, so only enable this for processors that actually care, e.g. output writers.
+    /// This must be called from the constructor, because the topology is built before Init() runs.
+    /// Ordering is only supported for processors at the top event level.
+
+    void SetEventsOrdered(bool receive_events_in_order) { m_receive_events_in_order = receive_events_in_order; }
 
 
 private:
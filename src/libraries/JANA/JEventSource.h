@@ -9,6 +9,11 @@
 #include <JANA/JEvent.h>
 #include <JANA/JException.h>
 #include <JANA/JFactoryGenerator.h>
+#include <JANA/Utils/JReadAheadRing.h>
+
+#include <cassert>
+#include <memory>
+#include <thread>
 
 
 class JFactoryGenerator;
@@ -39,7 +44,11 @@ public:
         }
 
     JEventSource() = default;
-    virtual ~JEventSource() = default;
+    virtual ~JEventSource() {
+        // The read-ahead thread calls the derived class's Read(), so it has to be stopped before the derived class is
+        // destroyed. DoClose() does that, and JComponentManager calls it on any source that is still open.
+        assert(!m_read_ahead_thread.joinable());
+    }
 
 
     // `Init` is where the user requests parameters and services. If the user requests all parameters and services here,
@@ -67,6 +76,53 @@ public:
     virtual Result Emit(JEvent&) { return Result::Success; };
 
 
+    // `EmitBatch` is an optional alternative to `Emit`, for sources where framing is cheap and events are small, so that
+    // the per-event overhead would dominate. JANA hands it up to `count` fresh events at once, and holds the source's
+    // lock for the whole call. The user fills events[0], events[1], ... in order, sets `emitted_count` to the number
+    // of events filled, and returns the Result of the attempt that ended the batch: Result::Success if all `count`
+    // events were filled, or FailureTryAgain or FailureFinished, exactly as with `Emit`. The events filled before a
+    // failure are emitted regardless. A barrier event (see JEvent::SetSequential) must be the last event of its batch.
+    // During the call, GetEventCount() refers to events[0]. The default implementation calls `Emit` once per event,
+    // advancing the event count in between, so that `Emit` sees the same count that it would outside of a batch.
+
+    virtual Result EmitBatch(JEvent** events, size_t count, size_t& emitted_count) {
+        emitted_count = 0;
+        Result result = Result::Success;
+        while (emitted_count < count) {
+            CallWithJExceptionWrapper("JEventSource::Emit", [&](){
+                result = Emit(*events[emitted_count]);
+            });
+            if (result != Result::Success) break;
+            emitted_count += 1;
+            m_event_count += 1;
+            if (events[emitted_count-1]->GetSequential()) break;
+        }
+        m_event_count -= emitted_count;  // DoNextBatch() does the real accounting
+        return result;
+    }
+
+
+    // `Seek` lets a source honor `jana:nskip` without emitting and discarding every skipped event. JANA calls it once,
+    // right after Open(), with the number of events to skip. The user positions the file or stream so that the next
+    // Emit() or GetEvent() produces the event at `event_index` (counting from 0), and returns true. The default returns
+    // false, in which case JANA falls back to emitting the skipped events and throwing them away. Seeking past the
+    // end is fine; the next Emit() simply reports FailureFinished. See JEventIndex for a reusable offset table.
+
+    virtual bool Seek(uint64_t /*event_index*/) { return false; }
+
+
+    // `Read` is only needed by sources that opt into read-ahead via SetReadAheadDepth(). JANA calls it repeatedly from
+    // the source's own I/O thread, starting right after Open(), without holding the source's lock. The user appends the
+    // next chunk of raw data from the file or socket to `block`, which arrives empty but with its capacity intact,
+    // and returns Result::Success. Result::FailureTryAgain means that no data is available yet, so JANA waits a moment
+    // and calls Read again. Result::FailureFinished means that there is no more data. Meanwhile, Emit only parses
+    // blocks that were already read, which it obtains via NextBlock(). A block may hold any number of events.
+
+    virtual Result Read(std::vector<char>& /*block*/) {
+        throw JException("JEventSource has read-ahead enabled, but does not implement Read()");
+    }
+
+
     /// `Close` is called by JANA when it is finished accepting events from this event source. Here is where you should
     /// cleanly close files, sockets, etc. Although GetEvent() knows when (for instance) there are no more events in a
     /// file, the logic for closing needs to live here because there are other ways a computation may end besides
@@ -95,6 +151,11 @@ public:
 
     virtual void GetEvent(std::shared_ptr<JEvent>) {};
 
+    /// `Preprocess` is where the expensive part of turning raw data into objects belongs. JANA calls it for every event
+    /// this source emitted, right after Emit() or GetEvent(), but in parallel and without holding the source's lock.
+    /// Emit() then only needs to frame the event and insert its raw bytes, so that the serial part stays short.
+    /// Since many events get preprocessed at once, this must not modify the source's own state.
+
     virtual void Preprocess(const JEvent&) {};
 
 
@@ -139,6 +200,8 @@ public:
                 throw JException("Attempted to open a JEventSource that hasn't been initialized!");
             }
             CallWithJExceptionWrapper("JEventSource::Open", [&](){ Open();});
+            SkipWithSeek();
+            StartReadAhead();
             if (GetResourceName().empty()) {
                 LOG_INFO(GetLogger()) << "Opened JEventSource '" << GetTypeName() << "'" << LOG_END;
             }
@@ -152,6 +215,8 @@ public:
                 throw JException("Attempted to open a JEventSource that hasn't been initialized!");
             }
             CallWithJExceptionWrapper("JEventSource::Open", [&](){ Open();});
+            SkipWithSeek();
+            StartReadAhead();
             if (GetResourceName().empty()) {
                 LOG_INFO(GetLogger()) << "Opened JEventSource '" << GetTypeName() << "'" << LOG_END;
             }
@@ -168,6 +233,7 @@ public:
 
             if (m_status != JEventSource::Status::Opened) return;
 
+            StopReadAhead();
             CallWithJExceptionWrapper("JEventSource::Close", [&](){ Close();});
             if (GetResourceName().empty()) {
                 LOG_INFO(GetLogger()) << "Closed JEventSource '" << GetTypeName() << "'" << LOG_END;
@@ -180,6 +246,7 @@ public:
         else {
             if (m_status != JEventSource::Status::Opened) return;
 
+            StopReadAhead();
             CallWithJExceptionWrapper("JEventSource::Close", [&](){ Close();});
             if (GetResourceName().empty()) {
                 LOG_INFO(GetLogger()) << "Closed JEventSource '" << GetTypeName() << "'" << LOG_END;
@@ -204,18 +271,18 @@ public:
         }
 
         auto first_evt_nr = m_nskip;
-        auto last_evt_nr = m_nevents + m_nskip;
 
         if (m_status == Status::Initialized) {
             DoOpen(false);
         }
         if (m_status == Status::Opened) {
-            if (m_nevents != 0 && (m_event_count == last_evt_nr)) {
+            if (m_nevents != 0 && (m_emitted_event_count == m_nevents)) {
                 // We exit early (and recycle) because we hit our jana:nevents limit
                 DoClose(false);
                 return Result::FailureFinished;
             }
             // If we reach this point, we will need to actually read an event
+            SeekToShard();
 
             // We configure the event
             event->SetEventNumber(m_event_count); // Default event number to event count
@@ -238,11 +305,15 @@ public:
                 for (auto* output : m_outputs) {
                     output->InsertCollection(*event);
                 }
-                if (m_event_count <= first_evt_nr) {
-                    // We immediately throw away this whole event because of nskip 
-                    // (although really we should be handling this with Seek())
+                if (m_event_count <= first_evt_nr || !IsInShard(m_event_count - first_evt_nr - 1)) {
+                    // We immediately throw away this whole event because of nskip or sharding
+                    // (only happens for sources that don't implement Seek())
+                    event->ClearData();
                     return Result::FailureTryAgain;
                 }
+                // Position in the sequence of events this source emitted, counting from 0. Used for ordered delivery
+                event->SetEventIndex(m_emitted_event_count);
+                m_emitted_event_count += 1;
                 return Result::Success;
             }
             else if (result == Result::FailureFinished) {
@@ -265,25 +336,144 @@ public:
         }
     }
 
+    /// DoNextBatch fills up to `count` events under a single lock acquisition, via EmitBatch(). The emitted events are
+    /// moved to the front of `events`, and their number is returned in `emitted_count`. Events that were filled but
+    /// dropped because of nskip or sharding are reused within the batch, so they don't end it. The result is Success if the batch
+    /// was filled or ended by a barrier event, and otherwise whatever stopped it. Like DoNext(), a FailureFinished
+    /// closes the source.
+    Result DoNextBatch(std::shared_ptr<JEvent>** events, size_t count, size_t& emitted_count) {
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        emitted_count = 0;
+
+        if (m_status == Status::Uninitialized) {
+            throw JException("JEventSource has not been initialized!");
+        }
+
+        if (m_callback_style == CallbackStyle::LegacyMode) {
+            while (emitted_count < count) {
+                auto result = DoNextCompatibility(*events[emitted_count]);
+                if (result != Result::Success) return result;
+                emitted_count += 1;
+                if ((*events[emitted_count-1])->GetSequential()) break;
+            }
+            return Result::Success;
+        }
+
+        auto first_evt_nr = m_nskip;
+
+        if (m_status == Status::Initialized) {
+            DoOpen(false);
+        }
+        while (emitted_count < count) {
+            if (m_status != Status::Opened) {
+                return Result::FailureFinished;
+            }
+            if (m_nevents != 0 && (m_emitted_event_count == m_nevents)) {
+                // We exit early because we hit our jana:nevents limit
+                DoClose(false);
+                return Result::FailureFinished;
+            }
+            SeekToShard();
+
+            // Never fill more events than jana:nevents still allows
+            size_t batch_count = count - emitted_count;
+            if (m_nevents != 0) {
+                batch_count = std::min<size_t>(batch_count, m_nevents - m_emitted_event_count);
+            }
+            // Don't read past the end of the current shard block, so that we can seek to our next one
+            if (m_shard_count > 1 && m_event_count >= first_evt_nr) {
+                batch_count = std::min<size_t>(batch_count, m_shard_block_size - (m_event_count - first_evt_nr) % m_shard_block_size);
+            }
+
+            // We configure the events
+            m_batch_events.clear();
+            m_batch_origins.clear();
+            for (size_t i=0; i<batch_count; ++i) {
+                auto& event = *events[emitted_count + i];
+                event->SetEventNumber(m_event_count + i); // Default event number to event count
+                event->SetJEventSource(this);
+                event->SetSequential(false);
+                event->GetJCallGraphRecorder()->Reset();
+                // (see note at top of JCallGraphRecorder.h)
+                m_batch_origins.push_back(event->GetJCallGraphRecorder()->SetInsertDataOrigin(JCallGraphRecorder::ORIGIN_FROM_SOURCE));
+                m_batch_events.push_back(event.get());
+            }
+
+            // Now we call the new-style interface
+            size_t filled_count = 0;
+            JEventSource::Result result;
+            CallWithJExceptionWrapper("JEventSource::EmitBatch", [&](){
+                result = EmitBatch(m_batch_events.data(), batch_count, filled_count);
+            });
+            if (filled_count > batch_count) {
+                throw JException("JEventSource::EmitBatch reported %zu events filled, but was only given %zu", filled_count, batch_count);
+            }
+
+            // Move the emitted events to the front, keeping their order. Events dropped due to nskip or sharding end up
+            // behind them, so that the next round can reuse them.
+            size_t batch_start = emitted_count;
+            bool found_barrier = false;
+            for (size_t i=0; i<batch_count; ++i) {
+                auto& event = *events[batch_start + i];
+                event->GetJCallGraphRecorder()->SetInsertDataOrigin(m_batch_origins[i]);
+                if (i >= filled_count) continue;
+                if (found_barrier) {
+                    throw JException("JEventSource::EmitBatch emitted events after a barrier event");
+                }
+                m_event_count += 1;
+                for (auto* output : m_outputs) {
+                    output->InsertCollection(*event);
+                }
+                if (m_event_count <= first_evt_nr || !IsInShard(m_event_count - first_evt_nr - 1)) {
+                    // We throw away this whole event because of nskip or sharding. The next round refills it,
+                    // so it must not keep anything that Emit() or InsertCollection() put there.
+                    event->ClearData();
+                    continue;
+                }
+                // Position in the sequence of events this source emitted, counting from 0. Used for ordered delivery
+                event->SetEventIndex(m_emitted_event_count);
+                m_emitted_event_count += 1;
+                found_barrier = event->GetSequential();
+                std::swap(events[emitted_count], events[batch_start + i]);
+                emitted_count += 1;
+            }
+
+            if (result == Result::FailureFinished) {
+                DoClose(false);
+                return Result::FailureFinished;
+            }
+            else if (result == Result::FailureTryAgain) {
+                return Result::FailureTryAgain;
+            }
+            else if (result != Result::Success) {
+                throw JException("Invalid JEventSource::Result value!");
+            }
+            if (found_barrier) break;
+        }
+        return Result::Success;
+    }
+
     Result DoNextCompatibility(std::shared_ptr<JEvent> event) {
 
         auto first_evt_nr = m_nskip;
-        auto last_evt_nr = m_nevents + m_nskip;
 
         try {
             if (m_status == Status::Initialized) {
                 DoOpen(false);
             }
             if (m_status == Status::Opened) {
-                if (m_event_count < first_evt_nr) {
-                    // Skip these events due to nskip
+                SeekToShard();
+                if (m_event_count < first_evt_nr || !IsInShard(m_event_count - first_evt_nr)) {
+                    // Skip these events due to nskip or sharding
                     event->SetEventNumber(m_event_count); // Default event number to event count
                     auto previous_origin = event->GetJCallGraphRecorder()->SetInsertDataOrigin( JCallGraphRecorder::ORIGIN_FROM_SOURCE);  // (see note at top of JCallGraphRecorder.h)
                     GetEvent(event);
                     event->GetJCallGraphRecorder()->SetInsertDataOrigin( previous_origin );
+                    event->ClearData();
                     m_event_count += 1;
                     return Result::FailureTryAgain;  // Reject this event and recycle it
-                } else if (m_nevents != 0 && (m_event_count == last_evt_nr)) {
+                } else if (m_nevents != 0 && (m_emitted_event_count == m_nevents)) {
                     // Declare ourselves finished due to nevents
                     DoClose(false); // Close out the event source as soon as it declares itself finished
                     return Result::FailureFinished;
@@ -301,7 +491,9 @@ public:
                         output->InsertCollection(*event);
                     }
                     event->GetJCallGraphRecorder()->SetInsertDataOrigin( previous_origin );
+                    event->SetEventIndex(m_emitted_event_count);
                     m_event_count += 1;
+                    m_emitted_event_count += 1;
                     return Result::Success; // Don't reject this event!
                 }
             } else if (m_status == Status::Closed) {
@@ -360,11 +552,20 @@ public:
         }
     }
 
+    void DoPreprocess(const JEvent& event) {
+        CallWithJExceptionWrapper("JEventSource::Preprocess", [&](){ Preprocess(event); });
+    }
+
     /// Calls the optional-and-discouraged user-provided FinishEvent virtual method, enforcing
     /// 1. Thread safety
     /// 2. The m_enable_free_event flag
+    /// Also counts the events that were emitted and have now finished, so that barrier events can wait for them.
 
     void DoFinish(JEvent& event) {
+        // Only events that DoNext() emitted have an index. The event pool clears it when recycling the event.
+        if (event.GetEventIndex() >= 0) {
+            m_finished_event_count += 1;
+        }
         if (m_enable_free_event) {
             std::lock_guard<std::mutex> lock(m_mutex);
             CallWithJExceptionWrapper("JEventSource::FinishEvent", [&](){
@@ -385,6 +586,22 @@ public:
             }
         }
 
+        if (m_read_ahead_depth != 0) {
+            auto stall_ms = [](JReadAheadRing::clock_t::duration d) {
+                return std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(d).count());
+            };
+            result->AddDetail("read_ahead_depth", [this](){ return std::to_string(m_read_ahead_depth); });
+            result->AddDetail("read_ahead_max_occupancy", [this](){
+                return std::to_string(m_read_ahead_ring ? m_read_ahead_ring->get_max_size() : 0);
+            });
+            result->AddDetail("read_ahead_reader_stall_ms", [this, stall_ms](){
+                return stall_ms(m_read_ahead_ring ? m_read_ahead_ring->get_producer_stall_time() : JReadAheadRing::clock_t::duration::zero());
+            });
+            result->AddDetail("read_ahead_emit_stall_ms", [this, stall_ms](){
+                return stall_ms(m_read_ahead_ring ? m_read_ahead_ring->get_consumer_stall_time() : JReadAheadRing::clock_t::duration::zero());
+            });
+        }
+
         summary.Add(result);
     }
 
@@ -396,6 +613,36 @@ public:
 
     uint64_t GetEventCount() const { return m_event_count; };
 
+    /// Enables read-ahead with a ring of `depth` raw blocks; 0 disables it. Call this before the source is opened,
+    /// e.g. from the constructor or Init(). See Read().
+    void SetReadAheadDepth(size_t depth) { m_read_ahead_depth = depth; }
+
+    size_t GetReadAheadDepth() const { return m_read_ahead_depth; }
+
+    /// Statistics of the read-ahead ring, or null if read-ahead is disabled or the source hasn't been opened yet
+    const JReadAheadRing* GetReadAheadRing() const { return m_read_ahead_ring.get(); }
+
+    /// Called from Emit() when using read-ahead. Swaps the oldest block read by Read() into `block`, and recycles
+    /// whatever `block` held before. Returns FailureTryAgain instead of waiting when the I/O thread hasn't caught up,
+    /// and FailureFinished once Read() has returned FailureFinished and every block has been handed out.
+    /// Exceptions thrown by Read() are rethrown here.
+    Result NextBlock(std::vector<char>& block) {
+        if (m_read_ahead_ring == nullptr) {
+            throw JException("JEventSource::NextBlock() called, but read-ahead is not enabled");
+        }
+        switch (m_read_ahead_ring->try_pop(block)) {
+            case JReadAheadRing::PopResult::Success: return Result::Success;
+            case JReadAheadRing::PopResult::Empty: return Result::FailureTryAgain;
+            default: return Result::FailureFinished;
+        }
+    }
+
+    /// Number of events that DoNext() has handed to JANA, not counting those skipped via jana:nskip
+    uint64_t GetEmittedEventCount() const { return m_emitted_event_count; };
+
+    /// Number of emitted events that have since been returned to the event pool
+    uint64_t GetFinishedEventCount() const { return m_finished_event_count; };
+
     // TODO: Deprecate me
     virtual std::string GetType() const { return m_type_name; }
 
@@ -425,13 +672,125 @@ public:
     // Meant to be called by JANA
     void SetNSkip(uint64_t nskip) { m_nskip = nskip; };
 
+    // Meant to be called by JANA
+    /// Restricts this source to its share of the events, for running `shard_count` independent processes over the
+    /// same inputs. After nskip, the events are dealt out in round-robin blocks of `block_size` events, and this source
+    /// keeps the blocks belonging to shard `shard_index`. jana:nevents then limits the events emitted from this share.
+    void SetShard(size_t shard_index, size_t shard_count, size_t block_size) {
+        if (shard_count == 0 || shard_index >= shard_count || block_size == 0) {
+            throw JException("Invalid sharding: jana:shard_index=%zu, jana:shard_count=%zu, jana:shard_block_size=%zu",
+                             shard_index, shard_count, block_size);
+        }
+        m_shard_index = shard_index;
+        m_shard_count = shard_count;
+        m_shard_block_size = block_size;
+    }
+
 
 private:
     std::string m_resource_name;
     std::atomic_ullong m_event_count {0};
+    std::atomic_ullong m_emitted_event_count {0};
+    std::atomic_ullong m_finished_event_count {0};
+    std::vector<JEvent*> m_batch_events;  // Scratch space for DoNextBatch(), protected by m_mutex
+    std::vector<JCallGraphRecorder::JDataOrigin> m_batch_origins;
     uint64_t m_nskip = 0;
     uint64_t m_nevents = 0;
+    uint64_t m_shard_index = 0;
+    uint64_t m_shard_count = 1;
+    uint64_t m_shard_block_size = 100;
+    enum class SeekSupport { Unknown, Yes, No } m_seek_support = SeekSupport::Unknown;
     bool m_enable_free_event = false;
+    size_t m_read_ahead_depth = 0;
+    std::unique_ptr<JReadAheadRing> m_read_ahead_ring;
+    std::thread m_read_ahead_thread;
+
+    /// Calls Seek(), unless it already told us that it isn't supported. On success, DoNext() treats the events in
+    /// between as already emitted and discarded.
+    bool TrySeek(uint64_t event_index) {
+        if (m_seek_support == SeekSupport::No) return false;
+        if (m_read_ahead_thread.joinable()) {
+            // Read() may be using the file right now, and the ring already holds blocks from the old position.
+            // DoNext() falls back to reading and discarding instead. The nskip seek happens before the thread starts.
+            return false;
+        }
+        bool success = false;
+        CallWithJExceptionWrapper("JEventSource::Seek", [&](){ success = Seek(event_index); });
+        m_seek_support = success ? SeekSupport::Yes : SeekSupport::No;
+        if (success) {
+            m_event_count = event_index;
+        }
+        return success;
+    }
+
+    void SkipWithSeek() {
+        if (m_nskip == 0 || m_event_count != 0) return;
+        if (TrySeek(m_nskip)) {
+            LOG_DEBUG(GetLogger()) << "Skipped " << m_nskip << " events using Seek()" << LOG_END;
+        }
+    }
+
+    /// Whether the event at `position`, counting from 0 after nskip, belongs to our shard
+    bool IsInShard(uint64_t position) const {
+        return (position / m_shard_block_size) % m_shard_count == m_shard_index;
+    }
+
+    /// Called before reading the event at m_event_count. If it belongs to another shard, jumps to the start of our
+    /// next block, as long as the source supports Seek() and isn't using read-ahead. Otherwise DoNext() reads and
+    /// discards the events in between.
+    void SeekToShard() {
+        if (m_shard_count == 1 || m_event_count < m_nskip || m_seek_support == SeekSupport::No) return;
+        uint64_t position = m_event_count - m_nskip;
+        uint64_t block = position / m_shard_block_size;
+        uint64_t blocks_ahead = (m_shard_index + m_shard_count - block % m_shard_count) % m_shard_count;
+        if (blocks_ahead == 0) return;
+        TrySeek(m_nskip + (block + blocks_ahead) * m_shard_block_size);
+    }
+
+    void StartReadAhead() {
+        if (m_read_ahead_depth == 0) return;
+        m_read_ahead_ring = std::make_unique<JReadAheadRing>(m_read_ahead_depth);
+        m_read_ahead_thread = std::thread(&JEventSource::RunReadAhead, this);
+    }
+
+    void StopReadAhead() {
+        if (!m_read_ahead_thread.joinable()) return;
+        m_read_ahead_ring->stop();
+        m_read_ahead_thread.join();
+        using std::chrono::duration_cast;
+        using std::chrono::milliseconds;
+        LOG_INFO(GetLogger()) << "Read-ahead for JEventSource '" << GetTypeName() << "': " << m_read_ahead_ring->get_block_count()
+                              << " blocks, max occupancy " << m_read_ahead_ring->get_max_size() << "/" << m_read_ahead_depth
+                              << ", reader stalled " << duration_cast<milliseconds>(m_read_ahead_ring->get_producer_stall_time()).count()
+                              << " ms, emit stalled " << duration_cast<milliseconds>(m_read_ahead_ring->get_consumer_stall_time()).count()
+                              << " ms" << LOG_END;
+    }
+
+    /// Body of the read-ahead thread
+    void RunReadAhead() {
+        JReadAheadRing::Block block;
+        try {
+            while (true) {
+                block.clear();
+                Result result;
+                CallWithJExceptionWrapper("JEventSource::Read", [&](){ result = Read(block); });
+                if (result == Result::Success) {
+                    if (!m_read_ahead_ring->push(block)) return;  // Stopped while waiting for space
+                }
+                else if (result == Result::FailureFinished) {
+                    m_read_ahead_ring->finish();
+                    return;
+                }
+                else if (m_read_ahead_ring->wait_for_stop(std::chrono::milliseconds(1))) {
+                    return;
+                }
+            }
+        }
+        catch (...) {
+            // Handed to whichever worker calls NextBlock() next, so that it surfaces like any other exception from Emit()
+            m_read_ahead_ring->finish(std::current_exception());
+        }
+    }
 
 };
 
@@ -0,0 +1,157 @@
+// Copyright 2024, Jefferson Science Associates, LLC.
+// Subject to the terms in the LICENSE file found in the top-level directory.
+
+#include <JANA/JEventSourceMmap.h>
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+JMmapFile::JMmapFile(const std::string& filename) {
+
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw JException("Unable to open '%s': %s", filename.c_str(), strerror(errno));
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        int err = errno;
+        ::close(fd);
+        throw JException("Unable to stat '%s': %s", filename.c_str(), strerror(err));
+    }
+    m_size = static_cast<size_t>(st.st_size);
+#ifdef __APPLE__
+    const struct timespec& mtime = st.st_mtimespec;
+#else
+    const struct timespec& mtime = st.st_mtim;
+#endif
+    m_stamp.size = m_size;
+    m_stamp.mtime_ns = static_cast<int64_t>(mtime.tv_sec) * 1000000000 + mtime.tv_nsec;
+    m_stamp.inode = static_cast<uint64_t>(st.st_ino);
+    if (m_size == 0) {
+        // mmap() refuses zero-length mappings, and there is nothing to read anyway
+        ::close(fd);
+        return;
+    }
+    void* data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    int err = errno;
+    ::close(fd);  // The mapping keeps its own reference to the file
+    if (data == MAP_FAILED) {
+        throw JException("Unable to mmap '%s': %s", filename.c_str(), strerror(err));
+    }
+    // Purely a hint, so we don't care if it fails. The kernel reads ahead more aggressively and drops pages behind us.
+    ::madvise(data, m_size, MADV_SEQUENTIAL);
+    m_data = static_cast<const char*>(data);
+}
+
+
+JMmapFile::~JMmapFile() {
+    if (m_data != nullptr) {
+        ::munmap(const_cast<char*>(m_data), m_size);
+    }
+}
+
+
+void JEventSourceMmap::Open() {
+    m_file = std::make_shared<const JMmapFile>(GetResourceName());
+    m_offset = 0;
+    m_framed_count = 0;
+    m_is_index_complete = false;
+    m_is_index_loaded = m_enable_index &&
+                        m_index.Read(JEventIndex::GetSidecarFilename(GetResourceName()), m_file->GetFileStamp());
+    if (!m_is_index_loaded) {
+        m_index.Clear();
+    }
+}
+
+
+size_t JEventSourceMmap::FrameNextEvent() {
+
+    size_t available = m_file->GetSize() - m_offset;
+    if (available == 0) {
+        m_is_index_complete = (m_index.GetEventCount() == m_framed_count);
+        return 0;
+    }
+    size_t event_size = FindEventSize(m_file->GetData() + m_offset, available);
+    if (event_size == 0) {
+        LOG_WARN(GetLogger()) << "Ignoring " << available << " trailing bytes in '" << GetResourceName()
+                              << "' that don't form a complete event" << LOG_END;
+        m_offset = m_file->GetSize();
+        m_is_index_complete = (m_index.GetEventCount() == m_framed_count);
+        return 0;
+    }
+    if (event_size > available) {
+        throw JException("FindEventSize() returned %zu bytes at offset %zu, but only %zu bytes remain in '%s'",
+                         event_size, m_offset, available, GetResourceName().c_str());
+    }
+    // We can only extend the index if we haven't skipped over any events, e.g. via a loaded index
+    if (m_index.GetEventCount() == m_framed_count) {
+        m_index.Add(m_offset);
+    }
+    m_offset += event_size;
+    m_framed_count += 1;
+    return event_size;
+}
+
+
+JEventSource::Result JEventSourceMmap::Emit(JEvent& event) {
+
+    size_t event_offset = m_offset;
+    size_t event_size = FrameNextEvent();
+    if (event_size == 0) {
+        return Result::FailureFinished;
+    }
+
+    auto view = std::make_shared<JMmapView>();
+    view->data = m_file->GetData() + event_offset;
+    view->size = event_size;
+    view->file_offset = event_offset;
+    view->file = m_file;
+
+    auto* fac = event.Insert(view.get(), m_view_tag);
+    fac->SetFactoryFlag(JFactory::NOT_OBJECT_OWNER);
+    event.KeepAlive(view);
+
+    FillEvent(event, *view);
+    return Result::Success;
+}
+
+
+bool JEventSourceMmap::Seek(uint64_t event_index) {
+
+    if (event_index < m_index.GetEventCount()) {
+        m_offset = m_index.GetOffset(event_index);
+        m_framed_count = event_index;
+        return true;
+    }
+    if (m_is_index_loaded) {
+        // The index covers the whole file, so this is past the end
+        m_offset = m_file->GetSize();
+        m_framed_count = m_index.GetEventCount();
+        return true;
+    }
+    // No usable index, so we find the boundaries the slow way, building the index as we go
+    while (m_framed_count < event_index && FrameNextEvent() != 0) {}
+    return true;
+}
+
+
+void JEventSourceMmap::Close() {
+    if (m_enable_index && m_is_index_complete && !m_is_index_loaded) {
+        auto sidecar_filename = JEventIndex::GetSidecarFilename(GetResourceName());
+        try {
+            m_index.Write(sidecar_filename, m_file->GetFileStamp());
+            LOG_DEBUG(GetLogger()) << "Wrote event index '" << sidecar_filename << "' with " << m_index.GetEventCount() << " events" << LOG_END;
+        }
+        catch (JException& e) {
+            LOG_WARN(GetLogger()) << e.message << LOG_END;
+        }
+    }
+    // Events still in flight keep the mapping alive through their views
+    m_file = nullptr;
+}
+
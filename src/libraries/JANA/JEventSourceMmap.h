@@ -0,0 +1,107 @@
+// Copyright 2024, Jefferson Science Associates, LLC.
+// Subject to the terms in the LICENSE file found in the top-level directory.
+
+#pragma once
+
+#include <JANA/JEventSource.h>
+#include <JANA/JObject.h>
+#include <JANA/Utils/JEventIndex.h>
+
+#include <memory>
+#include <string>
+
+
+/// JMmapFile is a read-only memory mapping of a whole file. It is shared by every JMmapView into it, so the
+/// mapping lives until the last event that points into it has been recycled.
+class JMmapFile {
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+    JEventIndex::FileStamp m_stamp;
+
+public:
+    explicit JMmapFile(const std::string& filename);
+    ~JMmapFile();
+    JMmapFile(const JMmapFile&) = delete;
+    JMmapFile& operator=(const JMmapFile&) = delete;
+
+    const char* GetData() const { return m_data; }
+    size_t GetSize() const { return m_size; }
+    /// Size, modification time in nanoseconds, and inode, as of when the file was mapped
+    const JEventIndex::FileStamp& GetFileStamp() const { return m_stamp; }
+};
+
+
+/// JMmapView is a non-owning view of one event's raw bytes, straight out of the page cache. Decoders read `data`
+/// instead of receiving a copy. The view itself holds the mapping open.
+struct JMmapView : public JObject {
+    const char* data = nullptr;
+    size_t size = 0;
+    size_t file_offset = 0;
+    std::shared_ptr<const JMmapFile> file;
+
+    JOBJECT_PUBLIC(JMmapView)
+
+    void Summarize(JObjectSummary& summary) const override {
+        summary.add(size, "size", "%zu");
+        summary.add(file_offset, "file_offset", "%zu");
+    }
+};
+
+
+/// JEventSourceMmap is a base class for event sources that read flat binary files containing back-to-back events.
+/// Open() maps the file named by GetResourceName() and advises the kernel that it will be read sequentially. Each
+/// Emit() asks FindEventSize() where the next event ends, and inserts a JMmapView of it, so that no data is copied.
+/// The views are inserted with NOT_OBJECT_OWNER and are owned by the JEvent via KeepAlive(), which means that
+/// the mapping stays valid until JEventPool recycles the last event using it, even after Close().
+///
+/// Seek() uses the sidecar JEventIndex next to the file if there is a valid one, and otherwise scans ahead with
+/// FindEventSize(), which is still far cheaper than emitting the skipped events. Once a pass has framed every
+/// event in the file, the index gets written, so that later jobs can seek directly.
+///
+/// Subclasses implement FindEventSize(), and optionally FillEvent() to set the run number, event number, etc.
+/// Subclasses that override Open() or Close() need to call the versions here.
+class JEventSourceMmap : public JEventSource {
+    std::shared_ptr<const JMmapFile> m_file;
+    size_t m_offset = 0;
+    std::string m_view_tag;
+
+    JEventIndex m_index;
+    bool m_enable_index = true;
+    bool m_is_index_loaded = false;   // m_index came from the sidecar
+    size_t m_framed_count = 0;        // Events framed so far, which is also the position of the next one
+    bool m_is_index_complete = false; // Every event in the file has been framed, starting from the beginning
+
+    /// Frames the event at m_offset and advances past it. Returns its size, or 0 at the end of the data.
+    size_t FrameNextEvent();
+
+public:
+    JEventSourceMmap() {
+        SetCallbackStyle(CallbackStyle::ExpertMode);
+    }
+
+    /// The boundary scanner. `data` points to the start of the next event, and `available` is the number of bytes
+    /// left in the file. Returns the size of the event in bytes, or 0 if the remaining bytes don't hold a complete
+    /// event. Throw a JException if the data is corrupt.
+    virtual size_t FindEventSize(const char* data, size_t available) = 0;
+
+    /// Called after the view has been inserted into the event
+    virtual void FillEvent(JEvent& /*event*/, const JMmapView& /*view*/) {}
+
+    void Open() override;
+    Result Emit(JEvent& event) override;
+    bool Seek(uint64_t event_index) override;
+    void Close() override;
+
+    /// Whether to read and write the sidecar event index. On by default. Failing to write it is only a warning.
+    void EnableEventIndex(bool enable) { m_enable_index = enable; }
+
+    const JEventIndex& GetEventIndex() const { return m_index; }
+    bool IsEventIndexLoaded() const { return m_is_index_loaded; }
+
+    /// Tag under which the JMmapView gets inserted
+    void SetViewTag(std::string tag) { m_view_tag = std::move(tag); }
+
+    /// The current mapping, or null if the source isn't open
+    const std::shared_ptr<const JMmapFile>& GetFile() const { return m_file; }
+};
+
@@ -155,6 +155,13 @@ public:
         return 0;
     }
 
+    /// Approximate number of bytes held by this factory's data for the current event. This feeds the event pool's
+    /// jana:max_bytes_in_flight budget. JFactoryT estimates it from the object count; override it if your objects
+    /// own significant memory of their own, e.g. hit vectors or waveforms.
+    virtual std::size_t GetMemoryUsage() const {
+        return 0;
+    }
+
 
     /// Access the encapsulated data, performing an upcast if necessary. This is useful for extracting data from
     /// all JFactories<T> where T extends a parent class S, such as JObject or TObject, in contexts where T is not known
@@ -222,6 +222,15 @@ void JFactorySet::Print() const
     }
 }
 
+/// GetMemoryUsage() adds up the estimated size of every contained factory's data
+size_t JFactorySet::GetMemoryUsage() const {
+    size_t total = 0;
+    for (const auto& sFactoryPair : mFactories) {
+        total += sFactoryPair.second->GetMemoryUsage();
+    }
+    return total;
+}
+
 /// Release() loops over all contained factories, clearing their data
 void JFactorySet::Release() {
 
@@ -31,6 +31,7 @@ class JFactorySet : public JResettable
         void Merge(JFactorySet &aFactorySet);
         void Print(void) const;
         void Release(void);
+        size_t GetMemoryUsage() const;
 
         JFactory* GetFactory(const std::string& object_name, const std::string& tag="") const;
         template<typename T> JFactoryT<T>* GetFactory(const std::string& tag = "") const;
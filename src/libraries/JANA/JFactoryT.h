@@ -74,6 +74,10 @@ public:
         return mData.size();
     }
 
+    std::size_t GetMemoryUsage() const override {
+        return mData.size() * sizeof(T);
+    }
+
     /// CreateAndGetData handles all the preconditions and postconditions involved in calling the user-defined Open(),
     /// ChangeRun(), and Process() methods. These include making sure the JFactory JApplication is set, Init() is called
     /// exactly once, exceptions are tagged with the originating plugin and eventsource, ChangeRun() is
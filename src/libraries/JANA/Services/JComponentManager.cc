@@ -15,6 +15,14 @@ JComponentManager::JComponentManager() {}
 JComponentManager::~JComponentManager() {
 
     for (auto* src : m_evt_srces) {
+        // A topology that was paused and never finalized leaves its sources open. Close them while the derived
+        // object is still alive, so that any read-ahead thread stops before it can call into a destroyed Read().
+        try {
+            src->DoClose();
+        }
+        catch (std::exception& e) {
+            LOG_ERROR(src->GetLogger()) << "Exception while closing JEventSource '" << src->GetTypeName() << "' during shutdown: " << e.what() << LOG_END;
+        }
         delete src;
     }
     for (auto* proc : m_evt_procs) {
@@ -47,6 +55,10 @@ void JComponentManager::configure_components() {
             ->SetIsAdvanced(true);
     m_params->SetDefaultParameter("jana:nevents", m_nevents, "Max number of events that sources can emit");
     m_params->SetDefaultParameter("jana:nskip", m_nskip, "Number of events that sources should skip before starting emitting");
+    m_params->SetDefaultParameter("jana:shard_index", m_shard_index, "Which share of each source's events this process handles, from 0 to jana:shard_count-1");
+    m_params->SetDefaultParameter("jana:shard_count", m_shard_count, "Number of independent processes that split each source's events between them");
+    m_params->SetDefaultParameter("jana:shard_block_size", m_shard_block_size, "Number of consecutive events that go to the same shard. Higher => better I/O locality; Lower => better balance")
+            ->SetIsAdvanced(true);
     m_params->SetDefaultParameter("autoactivate", m_autoactivate, "List of factories to activate regardless of what the event processors request. Format is typename:tag,typename:tag");
     m_params->FilterParameters(m_default_tags, "DEFTAG:");
 
@@ -202,6 +214,7 @@ void JComponentManager::resolve_event_sources() {
         // take the nskip/nevent slice across the stream of events emitted by each JEventSource in turn.
         if (source->GetNSkip() == 0) source->SetNSkip(m_nskip);
         if (source->GetNEvents() == 0) source->SetNEvents(m_nevents);
+        source->SetShard(m_shard_index, m_shard_count, m_shard_block_size);
     }
 }
 
@@ -72,6 +72,9 @@ private:
 
     uint64_t m_nskip=0;
     uint64_t m_nevents=0;
+    size_t m_shard_index=0;
+    size_t m_shard_count=1;
+    size_t m_shard_block_size=100;
     std::string m_user_evt_src_typename = "";
     JEventSourceGenerator* m_user_evt_src_gen = nullptr;
 
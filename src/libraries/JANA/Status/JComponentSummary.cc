@@ -133,6 +133,16 @@ void PrintComponentTable(std::ostream& os, const JComponentSummary& cs) {
         comp_table | comp->GetTypeName() | comp->GetPrefix() | comp->GetLevel() | comp->GetPluginName();
     }
     os << comp_table;
+
+    for (const auto* comp : cs.GetAllComponents()) {
+        auto details = comp->GetDetails();
+        if (details.empty()) continue;
+        os << "  " << comp->GetTypeName() << ":";
+        for (const auto& detail : details) {
+            os << " " << detail.first << "=" << detail.second << ";";
+        }
+        os << std::endl;
+    }
 }
 
 
@@ -215,6 +225,18 @@ std::ostream& operator<<(std::ostream& os, const JComponentSummary::Component& c
         }
         os << table.Render();
     }
+
+    if (!c.GetDetails().empty()) {
+        os << std::endl;
+        os << "  Details:" << std::endl;
+        JTablePrinter table;
+        table.AddColumn("Name");
+        table.AddColumn("Value");
+        for (const auto& detail : c.GetDetails()) {
+            table | detail.first | detail.second;
+        }
+        os << table.Render();
+    }
     return os;
 }
 
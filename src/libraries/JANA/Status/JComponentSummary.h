@@ -5,6 +5,7 @@
 #pragma once
 #include <JANA/Utils/JEventLevel.h>
 
+#include <functional>
 #include <string>
 #include <vector>
 #include <map>
@@ -37,12 +38,16 @@ public:
         std::string m_plugin_name;
         std::vector<Collection*> m_inputs;
         std::vector<Collection*> m_outputs;
+        std::vector<std::pair<std::string, std::function<std::string()>>> m_details;
 
     public:
         Component(ComponentType component_type, std::string prefix, std::string type_name, JEventLevel level, std::string plugin_name)
             : m_component_type(component_type), m_prefix(prefix), m_type_name(type_name), m_level(level), m_plugin_name(plugin_name) {}
         void AddInput(Collection* input) { m_inputs.push_back(input); }
         void AddOutput(Collection* output) { m_outputs.push_back(output); }
+        /// Details are evaluated whenever the summary is printed, so that they can report runtime statistics.
+        /// The getter must stay valid for as long as the component does.
+        void AddDetail(std::string name, std::function<std::string()> getter) { m_details.push_back({name, getter}); }
         ComponentType GetComponentType() const { return m_component_type; }
         std::string GetPrefix() const { return m_prefix; }
         std::string GetTypeName() const { return m_type_name; }
@@ -55,6 +60,13 @@ public:
             }
             return results;
         }
+        std::vector<std::pair<std::string, std::string>> GetDetails() const {
+            std::vector<std::pair<std::string, std::string>> results;
+            for (const auto& detail : m_details) {
+                results.push_back({detail.first, detail.second()});
+            }
+            return results;
+        }
         std::vector<const Collection*> GetOutputs() const { 
             std::vector<const Collection*> results;
             for (Collection* c : m_outputs) {
@@ -4,6 +4,7 @@
 
 #pragma once
 #include <iostream>
+#include <array>
 #include <atomic>
 #include <cassert>
 #include <vector>
@@ -29,13 +30,12 @@ private:
     bool m_is_sink;         // Whether or not tnis arrow contributes to the final event count
     JArrowMetrics m_metrics;      // Performance information accumulated over all workers
 
-    mutable std::mutex m_arrow_mutex;  // Protects access to arrow properties
-
     // TODO: Get rid of me
-    size_t m_chunksize = 1;       // Number of items to pop off the input queue at once
+    std::atomic<size_t> m_chunksize {1};  // Max number of items to pop off the input queue at once. Read on every execute()
 
     friend class JScheduler;
     std::vector<JArrow *> m_listeners;    // Downstream Arrows
+    size_t m_index = 0;                   // Position in the scheduler's arrow states, assigned by JScheduler
 
 protected:
     // This is usable by subclasses.
@@ -50,6 +50,8 @@ public:
 
     std::string get_name() { return m_name; }
 
+    size_t get_index() const { return m_index; }
+
     void set_logger(JLogger logger) {
         m_logger = logger;
     }
@@ -60,18 +62,18 @@ public:
 
     // TODO: Get rid of me
     void set_chunksize(size_t chunksize) {
-        std::lock_guard<std::mutex> lock(m_arrow_mutex);
-        m_chunksize = chunksize;
+        m_chunksize.store(std::max<size_t>(chunksize, 1), std::memory_order_relaxed);
     }
 
     // TODO: Get rid of me
     size_t get_chunksize() const {
-        std::lock_guard<std::mutex> lock(m_arrow_mutex);
-        return m_chunksize;
+        return m_chunksize.load(std::memory_order_relaxed);
     }
 
 
     // TODO: Metrics should be encapsulated so that only actions are to update, clear, or summarize
+    // Note that JWorkers don't write here; they keep their own metrics, which JScheduler::collect_arrow_metrics()
+    // adds to these. This is for metrics recorded outside of any worker, e.g. by tests.
     JArrowMetrics& get_metrics() {
         return m_metrics;
     }
@@ -93,6 +95,15 @@ public:
     // TODO: Make no longer virtual
     virtual size_t get_pending();
 
+    /// Number of items this arrow's workers have stolen from other locations of its input queues
+    size_t get_steal_count();
+
+    /// Fullest input queue, as a fraction of its capacity. Arrows without input queues (e.g. sources) report 1.
+    double get_input_occupancy();
+
+    /// Free space on the fullest output queue, as a fraction of its capacity. Arrows without output queues report 1.
+    double get_output_headroom();
+
     // TODO: Get rid of me
     virtual size_t get_threshold();
 
@@ -109,15 +120,51 @@ public:
     };
 };
 
+/// Data holds the items an arrow has pulled from (or reserved on) one of its places during a single execute().
+/// Up to JANA2_ARROWDATA_MAX_SIZE items live inline, so the common case never touches the heap. Arrows that
+/// process larger chunks ask for a bigger capacity, which comes from a thread-local stack of scratch buffers.
+/// Data objects are created and destroyed in LIFO order within one execute(), so each worker only allocates
+/// these buffers the first time it needs them.
 template <typename T>
 struct Data {
-    std::array<T*, JANA2_ARROWDATA_MAX_SIZE> items;
+    std::array<T*, JANA2_ARROWDATA_MAX_SIZE> inline_items;
+    std::vector<T*> overflow_items;
+    T** items;
+    size_t capacity;
     size_t item_count = 0;
     size_t reserve_count = 0;
     size_t location_id;
 
-    Data(size_t location_id = 0) : location_id(location_id) {
-        items = {nullptr};
+    Data(size_t location_id = 0, size_t capacity = JANA2_ARROWDATA_MAX_SIZE) : capacity(capacity), location_id(location_id) {
+        inline_items = {nullptr};
+        if (capacity > JANA2_ARROWDATA_MAX_SIZE) {
+            auto& scratch = get_scratch_buffers();
+            if (!scratch.empty()) {
+                overflow_items = std::move(scratch.back());
+                scratch.pop_back();
+            }
+            overflow_items.assign(capacity, nullptr);  // Only reallocates if this buffer has never been this big
+            items = overflow_items.data();
+        }
+        else {
+            items = inline_items.data();
+        }
+    }
+
+    ~Data() {
+        if (overflow_items.capacity() != 0) {
+            get_scratch_buffers().push_back(std::move(overflow_items));
+        }
+    }
+
+    // items points into this object, so copying would leave it dangling
+    Data(const Data&) = delete;
+    Data& operator=(const Data&) = delete;
+
+private:
+    static std::vector<std::vector<T*>>& get_scratch_buffers() {
+        static thread_local std::vector<std::vector<T*>> scratch_buffers;
+        return scratch_buffers;
     }
 };
 
@@ -129,6 +176,8 @@ struct PlaceRefBase {
     size_t max_item_count = 1;
 
     virtual size_t get_pending() { return 0; }
+    virtual double get_occupancy() { return 0; }
+    virtual size_t get_steal_count() { return 0; }
     virtual size_t get_threshold() { return 0; }
     virtual void set_threshold(size_t) {}
 };
@@ -192,6 +241,26 @@ struct PlaceRef : public PlaceRefBase {
         return 0;
     }
 
+    /// Fraction of the queue's total capacity (across all locations) that is currently filled. Pools report 0.
+    double get_occupancy() override {
+        assert(place_ref != nullptr);
+        if (is_queue) {
+            auto queue = static_cast<JMailbox<T*>*>(place_ref);
+            double capacity = queue->get_threshold() * queue->get_locations_count();
+            return (capacity == 0) ? 1.0 : std::min(1.0, queue->size() / capacity);
+        }
+        return 0;
+    }
+
+    size_t get_steal_count() override {
+        assert(place_ref != nullptr);
+        if (is_input && is_queue) {
+            auto queue = static_cast<JMailbox<T*>*>(place_ref);
+            return queue->get_steal_count();
+        }
+        return 0;
+    }
+
     size_t get_threshold() override {
         assert(place_ref != nullptr);
         if (is_input && is_queue) {
@@ -214,13 +283,13 @@ struct PlaceRef : public PlaceRefBase {
         if (is_input) { // Actually pull the data
             if (is_queue) {
                 auto queue = static_cast<JMailbox<T*>*>(place_ref);
-                data.item_count = queue->pop_and_reserve(data.items.data(), min_item_count, max_item_count, data.location_id);
+                data.item_count = queue->pop_and_reserve(data.items, min_item_count, std::min(max_item_count, data.capacity), data.location_id);
                 data.reserve_count = data.item_count;
                 return (data.item_count >= min_item_count);
             }
             else {
                 auto pool = static_cast<JPool<T>*>(place_ref);
-                data.item_count = pool->pop(data.items.data(), min_item_count, max_item_count, data.location_id);
+                data.item_count = pool->pop(data.items, min_item_count, std::min(max_item_count, data.capacity), data.location_id);
                 data.reserve_count = 0;
                 return (data.item_count >= min_item_count);
             }
@@ -230,7 +299,7 @@ struct PlaceRef : public PlaceRefBase {
                 // Reserve a space on the output queue
                 data.item_count = 0;
                 auto queue = static_cast<JMailbox<T*>*>(place_ref);
-                data.reserve_count = queue->reserve(min_item_count, max_item_count, data.location_id);
+                data.reserve_count = queue->reserve(min_item_count, std::min(max_item_count, data.capacity), data.location_id);
                 return (data.reserve_count >= min_item_count);
             }
             else {
@@ -246,12 +315,12 @@ struct PlaceRef : public PlaceRefBase {
         assert(place_ref != nullptr);
         if (is_queue) {
             auto queue = static_cast<JMailbox<T*>*>(place_ref);
-            queue->push_and_unreserve(data.items.data(), data.item_count, data.reserve_count, data.location_id);
+            queue->push_and_unreserve(data.items, data.item_count, data.reserve_count, data.location_id);
         }
         else {
             if (is_input) {
                 auto pool = static_cast<JPool<T>*>(place_ref);
-                pool->push(data.items.data(), data.item_count, data.location_id);
+                pool->push(data.items, data.item_count, data.location_id);
             }
         }
     }
@@ -260,14 +329,14 @@ struct PlaceRef : public PlaceRefBase {
         assert(place_ref != nullptr);
         if (is_queue) {
             auto queue = static_cast<JMailbox<T*>*>(place_ref);
-            queue->push_and_unreserve(data.items.data(), data.item_count, data.reserve_count, data.location_id);
+            queue->push_and_unreserve(data.items, data.item_count, data.reserve_count, data.location_id);
             data.item_count = 0;
             data.reserve_count = 0;
             return is_input ? 0 : data.item_count;
         }
         else {
             auto pool = static_cast<JPool<T>*>(place_ref);
-            pool->push(data.items.data(), data.item_count, data.location_id);
+            pool->push(data.items, data.item_count, data.location_id);
             data.item_count = 0;
             data.reserve_count = 0;
             return 1;
@@ -283,6 +352,37 @@ inline size_t JArrow::get_pending() {
     return sum;
 }
 
+inline size_t JArrow::get_steal_count() {
+    size_t sum = 0;
+    for (PlaceRefBase* place : m_places) {
+        sum += place->get_steal_count();
+    }
+    return sum;
+}
+
+inline double JArrow::get_input_occupancy() {
+    double result = 1.0;
+    bool found_input_queue = false;
+    for (PlaceRefBase* place : m_places) {
+        if (place->is_input && place->is_queue) {
+            double occupancy = place->get_occupancy();
+            result = found_input_queue ? std::max(result, occupancy) : occupancy;
+            found_input_queue = true;
+        }
+    }
+    return result;
+}
+
+inline double JArrow::get_output_headroom() {
+    double result = 1.0;
+    for (PlaceRefBase* place : m_places) {
+        if (!place->is_input && place->is_queue) {
+            result = std::min(result, 1.0 - place->get_occupancy());
+        }
+    }
+    return result;
+}
+
 inline size_t JArrow::get_threshold() {
     size_t result = -1;
     for (PlaceRefBase* place : m_places) {
@@ -3,131 +3,108 @@
 // Subject to the terms in the LICENSE file found in the top-level directory.
 
 #pragma once
-#include <mutex>
+#include <JANA/Utils/JCpuInfo.h>
+#include <atomic>
 #include <chrono>
+#include <string>
 
-class JArrowMetrics {
+/// JArrowMetrics accumulates what an arrow got done: messages completed, queue visits, and time spent.
+/// Each instance has exactly one writer (normally the JWorker it belongs to) and any number of readers, so it
+/// needs no lock: the writer does plain relaxed loads and stores, and readers may observe fields from slightly
+/// different moments, which is fine for statistics. Instances are padded to a cache line so that workers updating
+/// their own metrics don't slow each other down. JScheduler::collect_arrow_metrics() sums them up when asked.
+class alignas(JANA2_CACHE_LINE_BYTES) JArrowMetrics {
 
 public:
     enum class Status {KeepGoing, ComeBackLater, Finished, NotRunYet, Error};
     using duration_t = std::chrono::steady_clock::duration;
 
 private:
-    mutable std::mutex m_mutex;
-    // Mutex is mutable so that we can lock before reading from a const ref
-
-    Status m_last_status;
-    size_t m_total_message_count;
-    size_t m_last_message_count;
-    size_t m_total_queue_visits;
-    size_t m_last_queue_visits;
-    duration_t m_total_latency;
-    duration_t m_last_latency;
-    duration_t m_total_queue_latency;
-    duration_t m_last_queue_latency;
+    std::atomic<Status> m_last_status {Status::NotRunYet};
+    std::atomic<size_t> m_total_message_count {0};
+    std::atomic<size_t> m_last_message_count {0};
+    std::atomic<size_t> m_total_queue_visits {0};
+    std::atomic<size_t> m_last_queue_visits {0};
+    std::atomic<duration_t> m_total_latency {duration_t::zero()};
+    std::atomic<duration_t> m_last_latency {duration_t::zero()};
+    std::atomic<duration_t> m_total_queue_latency {duration_t::zero()};
+    std::atomic<duration_t> m_last_queue_latency {duration_t::zero()};
 
 
     // TODO: We might want to add a timestamp, so that
     // the 'last_*' measurements can reflect the most recent value,
     // rather than the last-to-be-accumulated value.
 
-public:
-    void clear() {
+    template <typename T>
+    static T load(const std::atomic<T>& field) { return field.load(std::memory_order_relaxed); }
 
-        m_mutex.lock();
-        m_last_status = Status::NotRunYet;
-        m_total_message_count = 0;
-        m_last_message_count = 0;
-        m_total_queue_visits = 0;
-        m_last_queue_visits = 0;
-        m_total_latency = duration_t::zero();
-        m_last_latency = duration_t::zero();
-        m_total_queue_latency = duration_t::zero();
-        m_last_queue_latency = duration_t::zero();
-        m_mutex.unlock();
-    }
+    template <typename T>
+    static void store(std::atomic<T>& field, T value) { field.store(value, std::memory_order_relaxed); }
 
-    void take(JArrowMetrics& other) {
+    template <typename T>
+    static void add(std::atomic<T>& field, T delta) { field.store(field.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed); }
 
-        m_mutex.lock();
-        other.m_mutex.lock();
-
-        if (other.m_last_message_count != 0) {
-            m_last_message_count = other.m_last_message_count;
-            m_last_latency = other.m_last_latency;
-        }
+public:
+    JArrowMetrics() = default;
+    JArrowMetrics(const JArrowMetrics&) = delete;
+    JArrowMetrics& operator=(const JArrowMetrics&) = delete;
 
-        m_last_status = other.m_last_status;
-        m_total_message_count += other.m_total_message_count;
-        m_total_queue_visits += other.m_total_queue_visits;
-        m_last_queue_visits = other.m_last_queue_visits;
-        m_total_latency += other.m_total_latency;
-        m_total_queue_latency += other.m_total_queue_latency;
-        m_last_queue_latency = other.m_last_queue_latency;
-
-        other.m_last_status = Status::NotRunYet;
-        other.m_total_message_count = 0;
-        other.m_last_message_count = 0;
-        other.m_total_queue_visits = 0;
-        other.m_last_queue_visits = 0;
-        other.m_total_latency = duration_t::zero();
-        other.m_last_latency = duration_t::zero();
-        other.m_total_queue_latency = duration_t::zero();
-        other.m_last_queue_latency = duration_t::zero();
-        other.m_mutex.unlock();
-        m_mutex.unlock();
-    };
+    /// Writer only
+    void clear() {
+        store(m_last_status, Status::NotRunYet);
+        store(m_total_message_count, size_t(0));
+        store(m_last_message_count, size_t(0));
+        store(m_total_queue_visits, size_t(0));
+        store(m_last_queue_visits, size_t(0));
+        store(m_total_latency, duration_t::zero());
+        store(m_last_latency, duration_t::zero());
+        store(m_total_queue_latency, duration_t::zero());
+        store(m_last_queue_latency, duration_t::zero());
+    }
 
+    /// Writer only. Accumulates `other` into this, leaving `other` untouched.
     void update(const JArrowMetrics &other) {
 
-        m_mutex.lock();
-        other.m_mutex.lock();
-
-        if (other.m_last_message_count != 0) {
-            m_last_message_count = other.m_last_message_count;
-            m_last_latency = other.m_last_latency;
+        if (load(other.m_last_message_count) != 0) {
+            store(m_last_message_count, load(other.m_last_message_count));
+            store(m_last_latency, load(other.m_last_latency));
         }
-        m_total_latency += other.m_total_latency;
-        m_last_status = other.m_last_status;
-        m_total_message_count += other.m_total_message_count;
-        m_total_queue_visits += other.m_total_queue_visits;
-        m_last_queue_visits = other.m_last_queue_visits;
-        m_total_queue_latency += other.m_total_queue_latency;
-        m_last_queue_latency = other.m_last_queue_latency;
-        other.m_mutex.unlock();
-        m_mutex.unlock();
+        add(m_total_latency, load(other.m_total_latency));
+        store(m_last_status, load(other.m_last_status));
+        add(m_total_message_count, load(other.m_total_message_count));
+        add(m_total_queue_visits, load(other.m_total_queue_visits));
+        store(m_last_queue_visits, load(other.m_last_queue_visits));
+        add(m_total_queue_latency, load(other.m_total_queue_latency));
+        store(m_last_queue_latency, load(other.m_last_queue_latency));
     };
 
+    /// Writer only
     void update_finished() {
-        m_mutex.lock();
-        m_last_status = Status::Finished;
-        m_mutex.unlock();
+        store(m_last_status, Status::Finished);
     }
 
+    /// Writer only
     void update(const Status& last_status,
                 const size_t& message_count_delta,
                 const size_t& queue_visit_delta,
                 const duration_t& latency_delta,
                 const duration_t& queue_latency_delta) {
 
-        m_mutex.lock();
-        m_last_status = last_status;
+        store(m_last_status, last_status);
 
         if (message_count_delta > 0) {
             // We don't want to lose our most recent latency numbers
             // when the most recent execute() encounters an empty
             // queue and consequently processes zero items.
-            m_last_message_count = message_count_delta;
-            m_last_latency = latency_delta;
+            store(m_last_message_count, message_count_delta);
+            store(m_last_latency, latency_delta);
         }
-        m_total_message_count += message_count_delta;
-        m_total_queue_visits += queue_visit_delta;
-        m_last_queue_visits = queue_visit_delta;
-        m_total_latency += latency_delta;
-        m_total_queue_latency += queue_latency_delta;
-        m_last_queue_latency = queue_latency_delta;
-        m_mutex.unlock();
-
+        add(m_total_message_count, message_count_delta);
+        add(m_total_queue_visits, queue_visit_delta);
+        store(m_last_queue_visits, queue_visit_delta);
+        add(m_total_latency, latency_delta);
+        add(m_total_queue_latency, queue_latency_delta);
+        store(m_last_queue_latency, queue_latency_delta);
     };
 
     void get(Status& last_status,
@@ -138,29 +115,29 @@ public:
              duration_t& total_latency,
              duration_t& last_latency,
              duration_t& total_queue_latency,
-             duration_t& last_queue_latency) {
-
-        m_mutex.lock();
-        last_status = m_last_status;
-        total_message_count = m_total_message_count;
-        last_message_count = m_last_message_count;
-        total_queue_visits = m_total_queue_visits;
-        last_queue_visits = m_last_queue_visits;
-        total_latency = m_total_latency;
-        last_latency = m_last_latency;
-        total_queue_latency = m_total_queue_latency;
-        last_queue_latency = m_last_queue_latency;
-        m_mutex.unlock();
+             duration_t& last_queue_latency) const {
+
+        last_status = load(m_last_status);
+        total_message_count = load(m_total_message_count);
+        last_message_count = load(m_last_message_count);
+        total_queue_visits = load(m_total_queue_visits);
+        last_queue_visits = load(m_last_queue_visits);
+        total_latency = load(m_total_latency);
+        last_latency = load(m_last_latency);
+        total_queue_latency = load(m_total_queue_latency);
+        last_queue_latency = load(m_last_queue_latency);
+    }
+
+    size_t get_total_message_count() const {
+        return load(m_total_message_count);
     }
 
-    size_t get_total_message_count() {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        return m_total_message_count;
+    size_t get_total_queue_visits() const {
+        return load(m_total_queue_visits);
     }
 
-    Status get_last_status() {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        return m_last_status;
+    Status get_last_status() const {
+        return load(m_last_status);
     }
 
     void summarize() {
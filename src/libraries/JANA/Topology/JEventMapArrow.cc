@@ -20,10 +20,6 @@ JEventMapArrow::JEventMapArrow(std::string name,
                          output_queue,
                          nullptr) {}
 
-void JEventMapArrow::add_source(JEventSource* source) {
-    m_sources.push_back(source);
-}
-
 void JEventMapArrow::add_unfolder(JEventUnfolder* unfolder) {
     m_unfolders.push_back(unfolder);
 }
@@ -32,9 +28,10 @@ void JEventMapArrow::process(Event* event, bool& success, JArrowMetrics::Status&
     
 
     LOG_DEBUG(m_logger) << "JEventMapArrow '" << get_name() << "': Starting event# " << (*event)->GetEventNumber() << LOG_END;
-    for (JEventSource* source : m_sources) {
+    // Only the source that emitted this event knows how to decode it
+    if (JEventSource* source = (*event)->GetJEventSource()) {
         JCallGraphEntryMaker cg_entry(*(*event)->GetJCallGraphRecorder(), source->GetTypeName()); // times execution until this goes out of scope
-        source->Preprocess(**event);
+        source->DoPreprocess(**event);
     }
     for (JEventUnfolder* unfolder : m_unfolders) {
         JCallGraphEntryMaker cg_entry(*(*event)->GetJCallGraphRecorder(), unfolder->GetTypeName()); // times execution until this goes out of scope
@@ -13,16 +13,17 @@ class JEvent;
 using Event = std::shared_ptr<JEvent>;
 using EventQueue = JMailbox<Event*>;
 
+/// JEventMapArrow runs the parallel, per-event part of a source's work, i.e. JEventSource::Preprocess() for the
+/// source that emitted each event, plus any unfolders' Preprocess(). It sits between the (sequential) source arrow
+/// and everything downstream, so that Emit() only needs to frame the raw data.
 class JEventMapArrow : public JPipelineArrow<JEventMapArrow, Event> {
 
 private:
-    std::vector<JEventSource*> m_sources;
     std::vector<JEventUnfolder*> m_unfolders;
 
 public:
     JEventMapArrow(std::string name, EventQueue *input_queue, EventQueue *output_queue);
 
-    void add_source(JEventSource* source);
     void add_unfolder(JEventUnfolder* unfolder);
 
     void process(Event* event, bool& success, JArrowMetrics::Status& status);
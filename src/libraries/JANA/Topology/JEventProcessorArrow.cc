@@ -30,9 +30,9 @@ void JEventProcessorArrow::process(Event* event, bool& success, JArrowMetrics::S
 
     LOG_DEBUG(m_logger) << "JEventProcessorArrow '" << get_name() << "': Starting event# " << (*event)->GetEventNumber() << LOG_END;
     for (JEventProcessor* processor : m_processors) {
-        // TODO: Move me into JEventProcessor::DoMap
+        // TODO: Move me into JEventProcessor::DoPrefetch
         JCallGraphEntryMaker cg_entry(*(*event)->GetJCallGraphRecorder(), processor->GetTypeName()); // times execution until this goes out of scope
-        processor->DoMap(*event);
+        processor->DoPrefetch(*event);
     }
     LOG_DEBUG(m_logger) << "JEventProcessorArrow '" << get_name() << "': Finished event# " << (*event)->GetEventNumber() << LOG_END;
     success = true;
@@ -48,10 +48,7 @@ void JEventProcessorArrow::initialize() {
 }
 
 void JEventProcessorArrow::finalize() {
+    // Processors are finalized by their JEventReduceArrows, once the last event has been reduced
     LOG_DEBUG(m_logger) << "Finalizing arrow '" << get_name() << "'" << LOG_END;
-    for (auto processor : m_processors) {
-        processor->DoFinalize();
-        LOG_INFO(m_logger) << "Finalized JEventProcessor '" << processor->GetTypeName() << "'" << LOG_END;
-    }
 }
 
@@ -8,6 +8,10 @@
 
 class JEventPool;
 
+/// JEventProcessorArrow is the parallel half of running JEventProcessors: it prefetches every processor's inputs,
+/// which runs the factories. Process() itself happens downstream, in one sequential JEventReduceArrow per processor.
+/// This arrow initializes the processors; the reduce arrows finalize them.
+
 using Event = std::shared_ptr<JEvent>;
 using EventQueue = JMailbox<Event*>;
 
@@ -0,0 +1,47 @@
+
+// Copyright 2024, Jefferson Science Associates, LLC.
+// Subject to the terms in the LICENSE file found in the top-level directory.
+
+
+#include <JANA/Topology/JEventReduceArrow.h>
+#include <JANA/Utils/JEventPool.h>
+#include <JANA/JEventProcessor.h>
+
+
+JEventReduceArrow::JEventReduceArrow(std::string name,
+                                     JEventProcessor* processor,
+                                     EventQueue *input_queue,
+                                     EventQueue *output_queue,
+                                     JEventPool *pool)
+        : JPipelineArrow(std::move(name),
+                         false,
+                         false,
+                         true,
+                         input_queue,
+                         output_queue,
+                         pool)
+        , m_processor(processor) {}
+
+void JEventReduceArrow::process(Event* event, bool& success, JArrowMetrics::Status& status) {
+
+    LOG_DEBUG(m_logger) << "JEventReduceArrow '" << get_name() << "': Starting event# " << (*event)->GetEventNumber() << LOG_END;
+    {
+        JCallGraphEntryMaker cg_entry(*(*event)->GetJCallGraphRecorder(), m_processor->GetTypeName()); // times execution until this goes out of scope
+        m_processor->DoReduce(*event);
+    }
+    LOG_DEBUG(m_logger) << "JEventReduceArrow '" << get_name() << "': Finished event# " << (*event)->GetEventNumber() << LOG_END;
+    success = true;
+    status = JArrowMetrics::Status::KeepGoing;
+}
+
+void JEventReduceArrow::initialize() {
+    // The processor was already initialized by the JEventProcessorArrow upstream, which needs its configuration for prefetching
+    LOG_DEBUG(m_logger) << "Initializing arrow '" << get_name() << "'" << LOG_END;
+}
+
+void JEventReduceArrow::finalize() {
+    LOG_DEBUG(m_logger) << "Finalizing arrow '" << get_name() << "'" << LOG_END;
+    m_processor->DoFinalize();
+    LOG_INFO(m_logger) << "Finalized JEventProcessor '" << m_processor->GetTypeName() << "'" << LOG_END;
+}
+
@@ -0,0 +1,34 @@
+
+// Copyright 2024, Jefferson Science Associates, LLC.
+// Subject to the terms in the LICENSE file found in the top-level directory.
+
+#pragma once
+#include <JANA/JEventProcessor.h>
+#include <JANA/Topology/JPipelineArrow.h>
+
+class JEventPool;
+
+using Event = std::shared_ptr<JEvent>;
+using EventQueue = JMailbox<Event*>;
+
+/// JEventReduceArrow calls JEventProcessor::DoReduce() for a single processor. It is sequential, so the processor's
+/// lock is never contended, and it comes after the parallel JEventProcessorArrow that prefetched the processor's
+/// inputs. JTopologyBuilder chains one of these per processor. The arrow finalizes its processor.
+class JEventReduceArrow : public JPipelineArrow<JEventReduceArrow, Event> {
+
+private:
+    JEventProcessor* m_processor;
+
+public:
+    JEventReduceArrow(std::string name,
+                      JEventProcessor* processor,
+                      EventQueue *input_queue,
+                      EventQueue *output_queue,
+                      JEventPool *pool);
+
+    void process(Event* event, bool& success, JArrowMetrics::Status& status);
+
+    void initialize() final;
+    void finalize() final;
+};
+
@@ -0,0 +1,98 @@
+// Copyright 2024, Jefferson Science Associates, LLC.
+// Subject to the terms in the LICENSE file found in the top-level directory.
+
+
+#include <JANA/Topology/JEventReorderArrow.h>
+#include <JANA/JEvent.h>
+
+
+JEventReorderArrow::JEventReorderArrow(std::string name,
+                                       JMailbox<EventT*>* input_queue,
+                                       JMailbox<EventT*>* output_queue,
+                                       size_t capacity)
+        : JArrow(std::move(name), false, false, false)
+        , m_capacity(std::max<size_t>(capacity, 1)) {
+
+    m_input.set_queue(input_queue);
+    m_output.set_queue(output_queue);
+}
+
+
+void JEventReorderArrow::execute(JArrowMetrics& result, size_t location_id) {
+
+    auto start_total_time = std::chrono::steady_clock::now();
+
+    size_t chunksize = get_chunksize();
+    size_t buffered_count = m_buffered_count.load(std::memory_order_relaxed);
+    bool is_full = (buffered_count >= m_capacity);
+
+    // Reserve space downstream first, so that we know how many events we may release
+    Data<EventT> out_data {location_id, chunksize};
+    bool can_release = m_output.pull(out_data);
+
+    // Once the buffer is full, we take one event at a time and put it back unless it is the next one in its sequence
+    Data<EventT> in_data {location_id, is_full ? 1 : std::min(chunksize, m_capacity - buffered_count)};
+    bool found_input = m_input.pull(in_data);
+
+    auto start_processing_time = std::chrono::steady_clock::now();
+
+    size_t accepted_count = 0;
+    size_t returned_count = 0;
+    if (found_input) {
+        for (size_t i=0; i<in_data.item_count; ++i) {
+            EventT* event = in_data.items[i];
+            auto& sequence = m_sequences[(*event)->GetJEventSource()];
+            auto event_index = (*event)->GetEventIndex();
+            if (is_full && event_index > sequence.next_index) {
+                in_data.items[returned_count++] = event;
+            }
+            else {
+                sequence.pending.emplace(event_index, event);
+                accepted_count++;
+            }
+        }
+    }
+    // Hands the rejected events back and releases the rest of the input reservation
+    in_data.item_count = returned_count;
+    m_input.push(in_data);
+
+    size_t released_count = 0;
+    if (can_release) {
+        for (auto& entry : m_sequences) {
+            auto& sequence = entry.second;
+            while (out_data.item_count < out_data.reserve_count && !sequence.pending.empty()) {
+                auto next = sequence.pending.begin();
+                // Events from before the current position (e.g. without an index) can't be reordered anymore, so they pass straight through
+                if (next->first > sequence.next_index) break;
+                if (next->first == sequence.next_index) sequence.next_index++;
+                out_data.items[out_data.item_count++] = next->second;
+                sequence.pending.erase(next);
+            }
+        }
+        released_count = out_data.item_count;
+    }
+    m_output.push(out_data);
+    m_buffered_count.store(buffered_count + accepted_count - released_count, std::memory_order_relaxed);
+
+    auto end_processing_time = std::chrono::steady_clock::now();
+    auto latency = (end_processing_time - start_processing_time);
+    auto overhead = (end_processing_time - start_total_time) - latency;
+
+    auto status = (accepted_count != 0 || released_count != 0) ? JArrowMetrics::Status::KeepGoing
+                                                                : JArrowMetrics::Status::ComeBackLater;
+    result.update(status, released_count, 1, latency, overhead);
+}
+
+
+void JEventReorderArrow::finalize() {
+    LOG_DEBUG(m_logger) << "Finalizing arrow '" << get_name() << "'" << LOG_END;
+    if (m_buffered_count != 0) {
+        LOG_ERROR(m_logger) << "Arrow '" << get_name() << "' finalized with " << m_buffered_count << " events still waiting to be reordered" << LOG_END;
+    }
+}
+
+
+size_t JEventReorderArrow::get_pending() {
+    return JArrow::get_pending() + m_buffered_count.load(std::memory_order_relaxed);
+}
+
@@ -0,0 +1,56 @@
+// Copyright 2024, Jefferson Science Associates, LLC.
+// Subject to the terms in the LICENSE file found in the top-level directory.
+
+#pragma once
+#include <JANA/Topology/JArrow.h>
+
+#include <limits>
+#include <map>
+
+class JEventSource;
+
+/// JEventReorderArrow restores source order in front of a JEventProcessor that called SetEventsOrdered(true).
+/// Events arrive in whatever order the parallel arrows upstream finished them. Each one is held back until every
+/// event that its JEventSource emitted before it has been passed on, according to the index that
+/// JEventSource::DoNext() assigned. Events from different sources are sequenced independently.
+///
+/// The buffer is bounded by `capacity`. Once it is full, the arrow stops taking events off its input queue
+/// except for the ones it can pass on immediately, and puts everything else back. The input queue then fills up,
+/// which throttles everything upstream via the usual JMailbox reservations, so a single slow event stalls the
+/// source instead of growing the buffer.
+class JEventReorderArrow : public JArrow {
+private:
+    using EventT = std::shared_ptr<JEvent>;
+
+    struct Sequence {
+        int64_t next_index = 0;
+        std::multimap<int64_t, EventT*> pending;
+    };
+
+    PlaceRef<EventT> m_input {this, true, 1, std::numeric_limits<size_t>::max()};
+    PlaceRef<EventT> m_output {this, false, 1, std::numeric_limits<size_t>::max()};
+
+    // Only touched by execute(), which is never called concurrently because this arrow is sequential
+    std::map<const JEventSource*, Sequence> m_sequences;
+
+    // Read by the scheduler via get_pending(), from any thread
+    std::atomic<size_t> m_buffered_count {0};
+    size_t m_capacity;
+
+public:
+    JEventReorderArrow(std::string name,
+                       JMailbox<EventT*>* input_queue,
+                       JMailbox<EventT*>* output_queue,
+                       size_t capacity);
+
+    void execute(JArrowMetrics& result, size_t location_id) final;
+
+    void finalize() final;
+
+    /// Includes the events held back in the buffer, so that the scheduler doesn't finalize this arrow early
+    size_t get_pending() override;
+
+    size_t get_buffered_count() const { return m_buffered_count.load(std::memory_order_relaxed); }
+    size_t get_capacity() const { return m_capacity; }
+};
+
@@ -1,4 +1,3 @@
-
 // Copyright 2020, Jefferson Science Associates, LLC.
 // Subject to the terms in the LICENSE file found in the top-level directory.
 
@@ -13,53 +12,255 @@
 JEventSourceArrow::JEventSourceArrow(std::string name,
                                      std::vector<JEventSource*> sources,
                                      EventQueue* output_queue,
-                                     JEventPool* pool
+                                     JEventPool* pool,
+                                     size_t max_open_sources
                                      )
-    : JPipelineArrow(name, false, true, false, nullptr, output_queue, pool), m_sources(sources) {
+    : JArrow(name, max_open_sources > 1 && sources.size() > 1, true, false)
+    , m_sources(sources)
+    , m_slot_count(std::min(std::max<size_t>(max_open_sources, 1), sources.size())) {
+
+    m_input.set_pool(pool);
+    m_output.set_queue(output_queue);
+
+    m_slots = std::unique_ptr<SourceSlot[]>(new SourceSlot[m_slot_count]);
+    for (size_t i=0; i<m_slot_count; ++i) {
+        m_slots[i].source_index = i;
+    }
+    m_next_source = m_slot_count;
 }
 
 
-void JEventSourceArrow::process(Event* event, bool& success, JArrowMetrics::Status& arrow_status) {
+void JEventSourceArrow::execute(JArrowMetrics& result, size_t location_id) {
+
+    auto start_total_time = clock_t::now();
+
+    if (m_barrier_active && execute_barrier(result, location_id, start_total_time)) {
+        return;
+    }
+
+    // If there are no sources left then we are finished.
+    if (m_finished_slot_count == m_slot_count) {
+        auto end_total_time = clock_t::now();
+        result.update(JArrowMetrics::Status::Finished, 0, 1, std::chrono::milliseconds(0), end_total_time - start_total_time);
+        return;
+    }
 
-    // If there are no sources available then we are automatically finished.
-    if (m_sources.empty()) {
-        success = false;
-        arrow_status = JArrowMetrics::Status::Finished;
+    // Registering as emitting before checking for a barrier means that either we see the barrier, or whoever
+    // wants to send the barrier sees us and waits until our events are counted as in flight.
+    m_emitting_count++;
+    size_t slot_index = m_barrier_active ? m_slot_count : claim_slot();
+    if (slot_index == m_slot_count) {
+        // Every unfinished source is already being read by another worker
+        m_emitting_count--;
+        auto end_total_time = clock_t::now();
+        result.update(JArrowMetrics::Status::ComeBackLater, 0, 1, std::chrono::milliseconds(0), end_total_time - start_total_time);
         return;
     }
+    SourceSlot& slot = m_slots[slot_index];
 
-    while (m_current_source < m_sources.size()) {
+    // Reserve space downstream first, so that we never pull more events than we are able to push.
+    size_t chunksize = get_chunksize();
+    Data<Event> out_data {location_id, chunksize};
+    bool success = m_output.pull(out_data);
 
-        auto source_status = m_sources[m_current_source]->DoNext(*event);
+    Data<Event> in_data {location_id, out_data.reserve_count};
+    success = success && m_input.pull(in_data);
+
+    if (!success) {
+        m_input.revert(in_data);
+        m_output.revert(out_data);
+        slot.is_claimed = false;
+        m_emitting_count--;
+        auto end_total_time = clock_t::now();
+        result.update(JArrowMetrics::Status::ComeBackLater, 0, 1, std::chrono::milliseconds(0), end_total_time - start_total_time);
+        return;
+    }
+
+    JArrowMetrics::Status process_status = JArrowMetrics::Status::KeepGoing;
+    size_t processed_count = 0;
+
+    auto start_processing_time = clock_t::now();
+    while (processed_count < in_data.item_count && !m_barrier_active) {
+        // Fill as much of the chunk as possible under a single acquisition of the source's lock
+        size_t emitted_count = 0;
+        auto source_status = m_sources[slot.source_index]->DoNextBatch(in_data.items + processed_count,
+                                                                       in_data.item_count - processed_count,
+                                                                       emitted_count);
+        for (size_t i=0; i<emitted_count; ++i) {
+            Event* event = in_data.items[processed_count++];
+            if ((*event)->GetSequential()) {
+                // Hold the barrier event back until everything emitted before it has finished.
+                // DoNextBatch() guarantees that it is the last event of its batch.
+                std::lock_guard<std::mutex> lock(m_barrier_mutex);
+                m_pending_barrier_events.push_back({event, clock_t::now()});
+                m_barrier_active = true;
+                LOG_DEBUG(m_logger) << "JEventSourceArrow '" << get_name() << "': Emitted barrier event #" << (*event)->GetEventNumber() << LOG_END;
+                break;
+            }
+            out_data.items[out_data.item_count++] = event;
+        }
 
         if (source_status == JEventSource::Result::FailureFinished) {
-            m_current_source++;
-            // TODO: Adjust nskip and nevents for the new source
+            if (advance_slot(slot)) continue;  // Try again with this slot's next source
+            process_status = (m_finished_slot_count == m_slot_count) ? JArrowMetrics::Status::Finished
+                                                                     : JArrowMetrics::Status::ComeBackLater;
+            break;
         }
-        else if (source_status == JEventSource::Result::FailureTryAgain){
-            // This JEventSource isn't finished yet, so we obtained either Success or TryAgainLater
-            success = false;
-            arrow_status = JArrowMetrics::Status::ComeBackLater;
-            return;
+        if (source_status == JEventSource::Result::FailureTryAgain) {
+            // This JEventSource isn't finished yet, but it doesn't have an event for us right now
+            process_status = JArrowMetrics::Status::ComeBackLater;
+            break;
+        }
+    }
+    auto end_processing_time = clock_t::now();
+    if (process_status == JArrowMetrics::Status::Finished && m_barrier_active) {
+        // We can't let the scheduler deactivate us while a barrier event is still waiting to be sent
+        process_status = JArrowMetrics::Status::ComeBackLater;
+    }
+    if (process_status != JArrowMetrics::Status::Finished && processed_count != 0) {
+        process_status = JArrowMetrics::Status::KeepGoing;
+    }
+
+    // Whatever we didn't get to goes back to the pool
+    for (size_t i=processed_count; i<in_data.item_count; ++i) {
+        in_data.items[i-processed_count] = in_data.items[i];
+    }
+    in_data.item_count -= processed_count;
+
+    m_input.push(in_data);
+    m_output.push(out_data);
+    slot.is_claimed = false;
+    m_emitting_count--;
+
+    auto end_total_time = clock_t::now();
+    auto latency = (end_processing_time - start_processing_time);
+    auto overhead = (end_total_time - start_total_time) - latency;
+    result.update(process_status, processed_count, 1, latency, overhead);
+}
+
+
+size_t JEventSourceArrow::claim_slot() {
+    size_t start = m_next_slot.fetch_add(1, std::memory_order_relaxed);
+    for (size_t i=0; i<m_slot_count; ++i) {
+        size_t slot_index = (start + i) % m_slot_count;
+        SourceSlot& slot = m_slots[slot_index];
+        if (slot.is_finished || slot.is_claimed.load(std::memory_order_relaxed)) continue;
+        bool expected = false;
+        if (slot.is_claimed.compare_exchange_strong(expected, true)) {
+            if (!slot.is_finished) return slot_index;
+            slot.is_claimed = false;
+        }
+    }
+    return m_slot_count;
+}
+
+
+bool JEventSourceArrow::advance_slot(SourceSlot& slot) {
+    std::lock_guard<std::mutex> lock(m_next_source_mutex);
+    if (m_next_source < m_sources.size()) {
+        slot.source_index = m_next_source++;
+        // TODO: Adjust nskip and nevents for the new source
+        return true;
+    }
+    slot.is_finished = true;
+    m_finished_slot_count++;
+    return false;
+}
+
+
+/// Sends or waits for pending barrier events. Returns false once there are no barrier events left, in which case
+/// the caller may go on emitting.
+bool JEventSourceArrow::execute_barrier(JArrowMetrics& result, size_t location_id, clock_t::time_point start_total_time) {
+
+    std::lock_guard<std::mutex> lock(m_barrier_mutex);
+    size_t held_count = m_pending_barrier_events.size();
+
+    if (m_barrier_in_flight) {
+        if (get_in_flight_count() != held_count) {
+            // The barrier event hasn't finished yet, so nothing after it may start
+            auto end_total_time = clock_t::now();
+            result.update(JArrowMetrics::Status::ComeBackLater, 0, 1, std::chrono::milliseconds(0), end_total_time - start_total_time);
+            return true;
+        }
+        auto now = clock_t::now();
+        auto process_time = now - m_barrier_release_time;
+        auto stall_time = now - m_barrier_emit_time;
+        m_total_barrier_process_time += process_time.count();
+        if (stall_time.count() > m_max_barrier_stall_time) {
+            m_max_barrier_stall_time = stall_time.count();
+        }
+        m_barrier_count++;
+        m_barrier_in_flight = false;
+        LOG_DEBUG(m_logger) << "JEventSourceArrow '" << get_name() << "': Barrier event finished after "
+                            << std::chrono::duration_cast<std::chrono::milliseconds>(process_time).count() << " ms" << LOG_END;
+    }
+
+    if (!m_pending_barrier_events.empty()) {
+        // The held barrier events are the only emitted events that haven't finished, so we can send the first one
+        Data<Event> out_data {location_id, 1};
+        if (m_emitting_count == 0 && get_in_flight_count() == held_count && m_output.pull(out_data)) {
+            m_barrier_emit_time = m_pending_barrier_events.front().second;
+            out_data.items[0] = m_pending_barrier_events.front().first;
+            out_data.item_count = 1;
+            m_output.push(out_data);
+            m_pending_barrier_events.pop_front();
+            m_barrier_in_flight = true;
+            m_barrier_release_time = clock_t::now();
+            auto drain_time = m_barrier_release_time - m_barrier_emit_time;
+            m_total_barrier_drain_time += drain_time.count();
+            LOG_DEBUG(m_logger) << "JEventSourceArrow '" << get_name() << "': Sending barrier event after "
+                                << std::chrono::duration_cast<std::chrono::milliseconds>(drain_time).count() << " ms" << LOG_END;
+
+            auto end_total_time = clock_t::now();
+            result.update(JArrowMetrics::Status::KeepGoing, 1, 1, std::chrono::milliseconds(0), end_total_time - start_total_time);
         }
         else {
-            success = true;
-            arrow_status = JArrowMetrics::Status::KeepGoing;
-            return;
+            auto end_total_time = clock_t::now();
+            result.update(JArrowMetrics::Status::ComeBackLater, 0, 1, std::chrono::milliseconds(0), end_total_time - start_total_time);
         }
+        return true;
     }
-    success = false;
-    arrow_status = JArrowMetrics::Status::Finished;
+
+    m_barrier_active = false;
+    return false;
+}
+
+
+size_t JEventSourceArrow::get_in_flight_count() {
+    size_t in_flight_count = 0;
+    for (JEventSource* source : m_sources) {
+        in_flight_count += source->GetEmittedEventCount() - source->GetFinishedEventCount();
+    }
+    return in_flight_count;
 }
 
 void JEventSourceArrow::initialize() {
-    // We initialize everything immediately, but don't open any resources until we absolutely have to; see process(): source->DoNext()
+    // We initialize everything immediately, but don't open any resources until we absolutely have to; see execute(): source->DoNext()
     for (JEventSource* source : m_sources) {
         source->DoInit();
     }
 }
 
 void JEventSourceArrow::finalize() {
+    {
+        // If execution stopped before the barrier events could be sent, they go back to the pool unprocessed
+        std::lock_guard<std::mutex> lock(m_barrier_mutex);
+        for (auto& pending : m_pending_barrier_events) {
+            Data<Event> pending_data {0, 1};
+            pending_data.items[0] = pending.first;
+            pending_data.item_count = 1;
+            m_input.push(pending_data);
+        }
+        m_pending_barrier_events.clear();
+    }
+    if (m_barrier_count != 0) {
+        using std::chrono::duration_cast;
+        using std::chrono::milliseconds;
+        LOG_INFO(m_logger) << "JEventSourceArrow '" << get_name() << "': Processed " << m_barrier_count << " barrier events. Stalled "
+                           << duration_cast<milliseconds>(get_total_barrier_drain_time()).count() << " ms draining before them and "
+                           << duration_cast<milliseconds>(get_total_barrier_process_time()).count() << " ms processing them; longest stall was "
+                           << duration_cast<milliseconds>(get_max_barrier_stall_time()).count() << " ms" << LOG_END;
+    }
     // Generally JEventSources finalize themselves as soon as they detect that they have run out of events.
     // However, we can't rely on the JEventSources turning themselves off since execution can be externally paused.
     // Instead we leave everything open until we finalize the whole topology, and finalize remaining event sources then.
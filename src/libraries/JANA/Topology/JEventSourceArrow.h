@@ -1,24 +1,97 @@
-
 // Copyright 2020, Jefferson Science Associates, LLC.
 // Subject to the terms in the LICENSE file found in the top-level directory.
 
 #pragma once
-#include <JANA/Topology/JPipelineArrow.h>
+#include <JANA/Topology/JArrow.h>
+
+#include <chrono>
+#include <deque>
+#include <limits>
+#include <mutex>
 
 using Event = std::shared_ptr<JEvent>;
 using EventQueue = JMailbox<Event*>;
 class JEventPool;
+class JEventSource;
+
+/// JEventSourceArrow pulls fresh events from the pool, fills them via JEventSource::DoNext(), and pushes them
+/// downstream.
+///
+/// The sources are read through up to `max_open_sources` slots. Each slot works through the sources in order,
+/// taking the next unread one whenever its current one is finished. A worker visiting the arrow claims a free slot
+/// and reads a chunk from that slot's source, so different workers read different sources at the same time. With a
+/// single slot (the default) the arrow is sequential and reads one source after another. Each source still numbers
+/// its own events, since only one worker at a time calls its DoNext().
+///
+/// It also implements barrier events, i.e. events for which the source called JEvent::SetSequential(true).
+/// A barrier event is held back until every event emitted before it has finished and been returned to the pool.
+/// Then it is sent through the topology on its own, and no further events are emitted until it has finished too.
+/// With several open sources, a barrier from any of them holds back all of them. Only this arrow stops emitting;
+/// everything downstream keeps running until it runs dry. The time spent waiting for the pipeline to drain and for
+/// the barrier itself is accumulated, and summarized when the arrow finalizes.
+class JEventSourceArrow : public JArrow {
+public:
+    using duration_t = std::chrono::steady_clock::duration;
 
-class JEventSourceArrow : public JPipelineArrow<JEventSourceArrow, Event> {
 private:
+    using clock_t = std::chrono::steady_clock;
+
+    struct alignas(JANA2_CACHE_LINE_BYTES) SourceSlot {
+        std::atomic<bool> is_claimed {false};
+        std::atomic<bool> is_finished {false};
+        size_t source_index = 0;    // Only touched by whoever claimed the slot
+    };
+
     std::vector<JEventSource*> m_sources;
-    size_t m_current_source = 0;
+    std::unique_ptr<SourceSlot[]> m_slots;
+    size_t m_slot_count;
+    std::atomic<size_t> m_finished_slot_count {0};
+    std::atomic<size_t> m_next_slot {0};  // Where the next worker starts looking for a free slot
+    std::mutex m_next_source_mutex;
+    size_t m_next_source = 0;             // First source that no slot has taken yet
+
+    PlaceRef<Event> m_input {this, true, 1, std::numeric_limits<size_t>::max()};
+    PlaceRef<Event> m_output {this, false, 1, std::numeric_limits<size_t>::max()};
+
+    // Barrier state. The atomics are checked on every execute(); everything else is protected by m_barrier_mutex.
+    std::atomic<bool> m_barrier_active {false};
+    std::atomic<size_t> m_emitting_count {0};   // Workers currently calling DoNext()
+    std::mutex m_barrier_mutex;
+    std::deque<std::pair<Event*, clock_t::time_point>> m_pending_barrier_events;
+    bool m_barrier_in_flight = false;
+    clock_t::time_point m_barrier_emit_time;
+    clock_t::time_point m_barrier_release_time;
+
+    // Barrier statistics. Written under m_barrier_mutex, read by anybody.
+    std::atomic<size_t> m_barrier_count {0};
+    std::atomic<duration_t::rep> m_total_barrier_drain_time {0};
+    std::atomic<duration_t::rep> m_total_barrier_process_time {0};
+    std::atomic<duration_t::rep> m_max_barrier_stall_time {0};
 
 public:
-    JEventSourceArrow(std::string name, std::vector<JEventSource*> sources, EventQueue* output_queue, JEventPool* pool);
+    JEventSourceArrow(std::string name, std::vector<JEventSource*> sources, EventQueue* output_queue, JEventPool* pool, size_t max_open_sources=1);
     void initialize() final;
     void finalize() final;
+    void execute(JArrowMetrics& result, size_t location_id) final;
+
+    size_t get_max_open_sources() const { return m_slot_count; }
+
+    /// Number of barrier events that have made it all the way through the topology
+    size_t get_barrier_count() const { return m_barrier_count; }
+
+    /// Total time spent waiting for earlier events to finish before sending a barrier event
+    duration_t get_total_barrier_drain_time() const { return duration_t(m_total_barrier_drain_time.load()); }
 
-    void process(Event* event, bool& success, JArrowMetrics::Status& status);
+    /// Total time spent waiting for the barrier events themselves to finish
+    duration_t get_total_barrier_process_time() const { return duration_t(m_total_barrier_process_time.load()); }
+
+    /// Longest time this arrow stopped emitting because of a single barrier event
+    duration_t get_max_barrier_stall_time() const { return duration_t(m_max_barrier_stall_time.load()); }
+
+private:
+    size_t claim_slot();
+    bool advance_slot(SourceSlot& slot);
+    bool execute_barrier(JArrowMetrics& result, size_t location_id, clock_t::time_point start_total_time);
+    size_t get_in_flight_count();
 };
 
@@ -5,7 +5,11 @@
 #pragma once
 #include <queue>
 #include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <functional>
 #include <JANA/Utils/JCpuInfo.h>
+#include <JANA/Utils/JProcessorMapping.h>
 #include <JANA/Services/JLoggingService.h>
 #include <JANA/JEvent.h>
 
@@ -26,9 +30,18 @@
 ///
 /// \tparam T must be moveable. Usually this is unique_ptr<JEvent>.
 ///
-/// Improvements:
-///   1. Pad LocalQueue
-///   2. Enable work stealing
+/// The default implementation keeps a mutex-protected std::deque per location. JRingMailbox
+/// overrides the same interface with a preallocated lock-free ring buffer; see jana:queue_impl.
+///
+/// When work stealing is enabled, a pop_and_reserve() that finds its own location empty falls back to
+/// taking a batch from the most-loaded sibling location. Siblings are grouped by their distance in the
+/// memory hierarchy (see JProcessorMapping::get_loc_distance), and the nearest group that has any work wins.
+/// Stolen items are reserved against the thief's location, so that they can be pushed back there if needed.
+///
+/// Each LocalQueue sits on its own cache line(s), so that workers at different locations don't false-share.
+/// Its item and reservation counts are mirrored into atomics, which are only written while holding the
+/// location's mutex. This lets size() and JArrow::get_pending() be called from inside the scheduler's
+/// critical section without acquiring any LocalQueue mutexes.
 
 
 class JQueue {
@@ -39,26 +52,60 @@ protected:
     int m_id = 0;
     JLogger m_logger;
 
+    // For each location, the sibling locations as (distance, location_id), sorted nearest first
+    std::vector<std::vector<std::pair<size_t, size_t>>> m_steal_order;
+    std::atomic<size_t> m_steal_count {0};
+
+    // Called after every push, so that idle workers can be woken up. See JParkingLot.
+    std::function<void()> m_push_notifier;
+
+    void notify_push() {
+        if (m_push_notifier) m_push_notifier();
+    }
+
 public:
     inline size_t get_threshold() { return m_capacity; }
     inline size_t get_locations_count() { return m_locations_count; }
     inline bool is_work_stealing_enabled() { return m_enable_work_stealing; }
     void set_logger(JLogger logger) { m_logger = logger; }
     void set_id(int id) { m_id = id; }
+    size_t get_steal_count() const { return m_steal_count; }
+    void set_push_notifier(std::function<void()> notifier) { m_push_notifier = std::move(notifier); }
+
+    /// Orders each location's siblings by their distance in the memory hierarchy, so that
+    /// work stealing prefers the nearest domain. Without this, all siblings are equidistant.
+    void set_processor_mapping(const JProcessorMapping& mapping) {
+        for (size_t loc=0; loc<m_locations_count; ++loc) {
+            auto& order = m_steal_order[loc];
+            for (auto& entry : order) {
+                entry.first = mapping.get_loc_distance(loc, entry.second);
+            }
+            std::stable_sort(order.begin(), order.end());
+        }
+    }
 
 
     inline JQueue(size_t threshold, size_t locations_count, bool enable_work_stealing)
-        : m_capacity(threshold), m_locations_count(locations_count), m_enable_work_stealing(enable_work_stealing) {}
+        : m_capacity(threshold), m_locations_count(locations_count), m_enable_work_stealing(enable_work_stealing) {
+
+        m_steal_order.resize(locations_count);
+        for (size_t loc=0; loc<locations_count; ++loc) {
+            for (size_t sibling=0; sibling<locations_count; ++sibling) {
+                if (sibling != loc) m_steal_order[loc].push_back({1, sibling});
+            }
+        }
+    }
     virtual ~JQueue() = default;
 };
 
 template <typename T>
 class JMailbox : public JQueue {
 
-    struct LocalQueue {
+    struct alignas(JANA2_CACHE_LINE_BYTES) LocalQueue {
         std::mutex mutex;
         std::deque<T> queue;
-        size_t reserved_count = 0;
+        std::atomic<size_t> item_count {0};       // Mirrors queue.size(). Written under mutex, read anywhere
+        std::atomic<size_t> reserved_count {0};   // Written under mutex, read anywhere
     };
 
     // TODO: Copy these params into DLMB for better locality
@@ -94,24 +141,28 @@ public:
     }
 
     // We can do this (for now) because we use a deque underneath, so threshold is 'soft'
-    inline void set_threshold(size_t threshold) { m_capacity = threshold; }
+    virtual void set_threshold(size_t threshold) { m_capacity = threshold; }
 
-    /// size() counts the number of items in the queue across all locations
-    /// This should be used sparingly because it will mess up a bunch of caches.
-    /// Meant to be used by measure_perf()
-    size_t size() {
+    /// size() counts the number of items in the queue across all locations.
+    /// This is wait-free, but the result is stale by the time the caller sees it.
+    /// Meant to be used by the scheduler's drain checks and measure_perf()
+    virtual size_t size() {
         size_t result = 0;
         for (size_t i = 0; i<m_locations_count; ++i) {
-            std::lock_guard<std::mutex> lock(m_queues[i].mutex);
-            result += m_queues[i].queue.size();
+            result += m_queues[i].item_count.load(std::memory_order_acquire);
         }
         return result;
     };
 
-    /// size(location_id) counts the number of items in the queue for a particular location
-    /// Meant to be used by Scheduler::next_assignment() and measure_perf(), eventually
-    size_t size(size_t location_id) {
-        return m_queues[location_id].queue.size();
+    /// size(location_id) counts the number of items in the queue for a particular location.
+    /// Wait-free, like size().
+    virtual size_t size(size_t location_id) {
+        return m_queues[location_id].item_count.load(std::memory_order_acquire);
+    }
+
+    /// get_reserved_count(location_id) counts the outstanding reservations for a particular location. Wait-free.
+    size_t get_reserved_count(size_t location_id) {
+        return m_queues[location_id].reserved_count.load(std::memory_order_acquire);
     }
 
     /// reserve(requested_count) keeps our queues bounded in size. The caller should
@@ -121,11 +172,12 @@ public:
     /// reserved on the output queue. Note that because the input queue may return
     /// fewer items than requested, the caller must push their original reserved_count
     /// alongside the items, to avoid a "reservation leak".
-    size_t reserve(size_t requested_count, size_t location_id = 0) {
+    virtual size_t reserve(size_t requested_count, size_t location_id = 0) {
 
         LocalQueue& mb = m_queues[location_id];
         std::lock_guard<std::mutex> lock(mb.mutex);
-        size_t doable_count = m_capacity - mb.queue.size() - mb.reserved_count;
+        size_t occupied_count = mb.queue.size() + mb.reserved_count;
+        size_t doable_count = (occupied_count < m_capacity) ? m_capacity - occupied_count : 0;
         if (doable_count > 0) {
             size_t reservation = std::min(doable_count, requested_count);
             mb.reserved_count += reservation;
@@ -138,7 +190,7 @@ public:
     /// succeed, although it may exceed the threshold if the caller didn't reserve
     /// space, and it may take a long time because it will wait on a mutex.
     /// Note that if the caller had called reserve(), they must pass in the reserved_count here.
-    Status push(std::vector<T>& buffer, size_t reserved_count = 0, size_t location_id = 0) {
+    virtual Status push(std::vector<T>& buffer, size_t reserved_count = 0, size_t location_id = 0) {
 
         auto& mb = m_queues[location_id];
         std::lock_guard<std::mutex> lock(mb.mutex);
@@ -147,6 +199,8 @@ public:
              mb.queue.push_back(std::move(t));
         }
         buffer.clear();
+        update_item_count(mb);
+        notify_push();
         if (mb.queue.size() > m_capacity) {
             return Status::Full;
         }
@@ -157,7 +211,7 @@ public:
     /// pop() will pop up to requested_count items for the desired location_id.
     /// If many threads are contending for the queue, this will fail with Status::Contention,
     /// in which case the caller should probably consult the Scheduler.
-    Status pop(std::vector<T>& buffer, size_t requested_count, size_t location_id = 0) {
+    virtual Status pop(std::vector<T>& buffer, size_t requested_count, size_t location_id = 0) {
 
         auto& mb = m_queues[location_id];
         if (!mb.mutex.try_lock()) {
@@ -170,6 +224,7 @@ public:
             mb.queue.pop_front();
         }
         auto size = mb.queue.size();
+        update_item_count(mb);
         mb.mutex.unlock();
         if (size >= m_capacity) {
             return Status::Full;
@@ -181,7 +236,7 @@ public:
     }
 
 
-    Status pop(T& item, bool& success, size_t location_id = 0) {
+    virtual Status pop(T& item, bool& success, size_t location_id = 0) {
 
         success = false;
         auto& mb = m_queues[location_id];
@@ -192,6 +247,7 @@ public:
         if (nitems > 1) {
             item = std::move(mb.queue.front());
             mb.queue.pop_front();
+            update_item_count(mb);
             success = true;
             mb.mutex.unlock();
             return Status::Ready;
@@ -199,6 +255,7 @@ public:
         else if (nitems == 1) {
             item = std::move(mb.queue.front());
             mb.queue.pop_front();
+            update_item_count(mb);
             success = true;
             mb.mutex.unlock();
             return Status::Empty;
@@ -210,18 +267,20 @@ public:
 
 
 
-    bool try_push(T* buffer, size_t count, size_t location_id = 0) {
+    virtual bool try_push(T* buffer, size_t count, size_t location_id = 0) {
         auto& mb = m_queues[location_id];
         std::lock_guard<std::mutex> lock(mb.mutex);
         if (mb.queue.size() + count > m_capacity) return false;
         for (size_t i=0; i<count; ++i) {
              mb.queue.push_back(buffer[i]);
-             buffer[i] = nullptr;
+             buffer[i] = T{};
         }
+        update_item_count(mb);
+        notify_push();
         return true;
     }
 
-    void push_and_unreserve(T* buffer, size_t count, size_t reserved_count = 0, size_t location_id = 0) {
+    virtual void push_and_unreserve(T* buffer, size_t count, size_t reserved_count = 0, size_t location_id = 0) {
 
         auto& mb = m_queues[location_id];
         std::lock_guard<std::mutex> lock(mb.mutex);
@@ -230,11 +289,13 @@ public:
         mb.reserved_count -= reserved_count;
         for (size_t i=0; i<count; ++i) {
              mb.queue.push_back(buffer[i]);
-             buffer[i] = nullptr;
+             buffer[i] = T{};
         }
+        update_item_count(mb);
+        if (count != 0) notify_push();
     }
 
-    size_t pop(T* buffer, size_t min_requested_count, size_t max_requested_count, size_t location_id = 0) {
+    virtual size_t pop(T* buffer, size_t min_requested_count, size_t max_requested_count, size_t location_id = 0) {
 
         auto& mb = m_queues[location_id];
         std::lock_guard<std::mutex> lock(mb.mutex);
@@ -247,31 +308,36 @@ public:
             buffer[i] = mb.queue.front();
             mb.queue.pop_front();
         }
+        update_item_count(mb);
         return nitems;
     }
 
-    size_t pop_and_reserve(T* buffer, size_t min_requested_count, size_t max_requested_count, size_t location_id = 0) {
-
-        auto& mb = m_queues[location_id];
-        std::lock_guard<std::mutex> lock(mb.mutex);
-
-        if (mb.queue.size() < min_requested_count) return 0;
-
-        auto nitems = std::min(max_requested_count, mb.queue.size());
-        mb.reserved_count += nitems;
-
-        for (size_t i=0; i<nitems; ++i) {
-            buffer[i] = mb.queue.front();
-            mb.queue.pop_front();
+    virtual size_t pop_and_reserve(T* buffer, size_t min_requested_count, size_t max_requested_count, size_t location_id = 0) {
+        {
+            auto& mb = m_queues[location_id];
+            std::lock_guard<std::mutex> lock(mb.mutex);
+
+            if (mb.queue.size() >= min_requested_count) {
+                auto nitems = std::min(max_requested_count, mb.queue.size());
+                mb.reserved_count += nitems;
+
+                for (size_t i=0; i<nitems; ++i) {
+                    buffer[i] = mb.queue.front();
+                    mb.queue.pop_front();
+                }
+                update_item_count(mb);
+                return nitems;
+            }
         }
-        return nitems;
+        return steal_and_reserve(buffer, min_requested_count, max_requested_count, location_id);
     }
 
-    size_t reserve(size_t min_requested_count, size_t max_requested_count, size_t location_id) {
+    virtual size_t reserve(size_t min_requested_count, size_t max_requested_count, size_t location_id) {
 
         LocalQueue& mb = m_queues[location_id];
         std::lock_guard<std::mutex> lock(mb.mutex);
-        size_t available_count = m_capacity - mb.queue.size() - mb.reserved_count;
+        size_t occupied_count = mb.queue.size() + mb.reserved_count;
+        size_t available_count = (occupied_count < m_capacity) ? m_capacity - occupied_count : 0;
         size_t count = std::min(available_count, max_requested_count);
         if (count < min_requested_count) {
             return 0;
@@ -280,7 +346,7 @@ public:
         return count;
     };
 
-    void unreserve(size_t reserved_count, size_t location_id) {
+    virtual void unreserve(size_t reserved_count, size_t location_id) {
 
         LocalQueue& mb = m_queues[location_id];
         std::lock_guard<std::mutex> lock(mb.mutex);
@@ -288,6 +354,57 @@ public:
         mb.reserved_count -= reserved_count;
     };
 
+    /// steal_and_reserve() is what pop_and_reserve() falls back to when location_id doesn't have enough items.
+    /// It picks a victim among the nearest sibling locations which have work, takes up to half of the victim's
+    /// backlog (bounded by max_requested_count), and reserves the items against location_id.
+    /// Returns 0 if work stealing is disabled or there is nothing worth stealing.
+    size_t steal_and_reserve(T* buffer, size_t min_requested_count, size_t max_requested_count, size_t location_id) {
+
+        if (!m_enable_work_stealing || m_locations_count < 2 || max_requested_count == 0) return 0;
+
+        size_t victim_size = 0;
+        size_t victim = find_steal_victim(location_id, std::max<size_t>(min_requested_count, 1), victim_size);
+        if (victim == location_id) return 0;
+
+        // Make sure the stolen items could be pushed back to our own location, e.g. by PlaceRef::revert
+        size_t batch_count = std::min(max_requested_count, std::max(min_requested_count, victim_size / 2));
+        size_t reserved_count = reserve(min_requested_count, batch_count, location_id);
+        if (reserved_count == 0) return 0;
+
+        size_t nitems = pop(buffer, min_requested_count, reserved_count, victim);
+        if (nitems < reserved_count) {
+            unreserve(reserved_count - nitems, location_id);
+        }
+        m_steal_count += nitems;
+        LOG_TRACE(m_logger) << "JMailbox: steal_and_reserve(): queue #" << m_id << ", location " << location_id << " stole " << nitems << " items from location " << victim << LOG_END;
+        return nitems;
+    }
+
+protected:
+
+    /// Must be called while holding mb.mutex, after every change to mb.queue
+    void update_item_count(LocalQueue& mb) {
+        mb.item_count.store(mb.queue.size(), std::memory_order_release);
+    }
+
+    /// Returns the most-loaded sibling with at least min_count items, considering only the nearest group of
+    /// siblings that has any. Returns location_id itself if no sibling qualifies.
+    size_t find_steal_victim(size_t location_id, size_t min_count, size_t& victim_size) {
+        size_t victim = location_id;
+        size_t victim_distance = 0;
+        victim_size = 0;
+        for (const auto& entry : m_steal_order[location_id]) {
+            if (victim != location_id && entry.first > victim_distance) break;
+            size_t candidate_size = size(entry.second);
+            if (candidate_size >= min_count && candidate_size > victim_size) {
+                victim = entry.second;
+                victim_size = candidate_size;
+                victim_distance = entry.first;
+            }
+        }
+        return victim;
+    }
+
 };
 
 template <>
@@ -303,25 +420,31 @@ inline void JMailbox<std::shared_ptr<JEvent>*>::push_and_unreserve(std::shared_p
         mb.queue.push_back(buffer[i]);
         buffer[i] = nullptr;
     }
-} 
+    update_item_count(mb);
+    if (count != 0) notify_push();
+}
 
 template <>
 inline size_t JMailbox<std::shared_ptr<JEvent>*>::pop_and_reserve(std::shared_ptr<JEvent>** buffer, size_t min_requested_count, size_t max_requested_count, size_t location_id) {
 
-    auto& mb = m_queues[location_id];
-    std::lock_guard<std::mutex> lock(mb.mutex);
-
-    if (mb.queue.size() < min_requested_count) return 0;
-
-    auto nitems = std::min(max_requested_count, mb.queue.size());
-    mb.reserved_count += nitems;
+    {
+        auto& mb = m_queues[location_id];
+        std::lock_guard<std::mutex> lock(mb.mutex);
 
-    for (size_t i=0; i<nitems; ++i) {
-        buffer[i] = mb.queue.front();
-        LOG_TRACE(m_logger) << "JMailbox: pop_and_reserve(): queue #" << m_id << ", event #" << buffer[i]->get()->GetEventNumber() << LOG_END;
-        mb.queue.pop_front();
+        if (mb.queue.size() >= min_requested_count) {
+            auto nitems = std::min(max_requested_count, mb.queue.size());
+            mb.reserved_count += nitems;
+
+            for (size_t i=0; i<nitems; ++i) {
+                buffer[i] = mb.queue.front();
+                LOG_TRACE(m_logger) << "JMailbox: pop_and_reserve(): queue #" << m_id << ", event #" << buffer[i]->get()->GetEventNumber() << LOG_END;
+                mb.queue.pop_front();
+            }
+            update_item_count(mb);
+            return nitems;
+        }
     }
-    return nitems;
+    return steal_and_reserve(buffer, min_requested_count, max_requested_count, location_id);
 }
 
 
@@ -8,11 +8,14 @@
 #include <JANA/Topology/JMailbox.h>
 #include <JANA/Topology/JPool.h>
 
+#include <limits>
+
 template <typename DerivedT, typename MessageT>
 class JPipelineArrow : public JArrow {
 private:
-    PlaceRef<MessageT> m_input {this, true, 1, 1};
-    PlaceRef<MessageT> m_output {this, false, 1, 1};
+    // The upper bound on the number of items per execute() comes from get_chunksize() via Data::capacity
+    PlaceRef<MessageT> m_input {this, true, 1, std::numeric_limits<size_t>::max()};
+    PlaceRef<MessageT> m_output {this, false, 1, std::numeric_limits<size_t>::max()};
 
 public:
     JPipelineArrow(std::string name,
@@ -45,10 +48,15 @@ public:
 
         auto start_total_time = std::chrono::steady_clock::now();
 
-        Data<MessageT> in_data {location_id};
-        Data<MessageT> out_data {location_id};
+        // Reserve space downstream first, so that we never pull more events than we are able to push.
+        // Pools don't need a reservation, so in that case the chunksize is the only limit.
+        size_t chunksize = get_chunksize();
+        Data<MessageT> out_data {location_id, chunksize};
+        bool success = m_output.pull(out_data);
+
+        Data<MessageT> in_data {location_id, m_output.is_queue ? out_data.reserve_count : chunksize};
+        success = success && m_input.pull(in_data);
 
-        bool success = m_input.pull(in_data) && m_output.pull(out_data);
         if (!success) {
             m_input.revert(in_data);
             m_output.revert(out_data);
@@ -59,20 +67,30 @@ public:
             return;
         }
 
+        // Process the whole chunk back-to-back. We stop early as soon as an event fails or the
+        // arrow asks us to stop (e.g. a source reports Finished or ComeBackLater)
         bool process_succeeded = true;
         JArrowMetrics::Status process_status = JArrowMetrics::Status::KeepGoing;
-        assert(in_data.item_count == 1);
-        MessageT* event = in_data.items[0];
+        size_t processed_count = 0;
 
         auto start_processing_time = std::chrono::steady_clock::now();
-        static_cast<DerivedT*>(this)->process(event, process_succeeded, process_status);
+        while (processed_count < in_data.item_count) {
+            MessageT* event = in_data.items[processed_count];
+            static_cast<DerivedT*>(this)->process(event, process_succeeded, process_status);
+            if (!process_succeeded) break;
+
+            out_data.items[out_data.item_count++] = event;
+            processed_count++;
+            if (process_status != JArrowMetrics::Status::KeepGoing) break;
+        }
         auto end_processing_time = std::chrono::steady_clock::now();
 
-        if (process_succeeded) {
-            in_data.item_count = 0;
-            out_data.item_count = 1;
-            out_data.items[0] = event;
+        // Whatever we didn't get to goes back where it came from
+        for (size_t i=processed_count; i<in_data.item_count; ++i) {
+            in_data.items[i-processed_count] = in_data.items[i];
         }
+        in_data.item_count -= processed_count;
+
         m_input.push(in_data);
         m_output.push(out_data);
 
@@ -80,6 +98,6 @@ public:
         auto end_total_time = std::chrono::steady_clock::now();
         auto latency = (end_processing_time - start_processing_time);
         auto overhead = (end_total_time - start_total_time) - latency;
-        result.update(process_status, process_succeeded, 1, latency, overhead);
+        result.update(process_status, processed_count, 1, latency, overhead);
     }
 };
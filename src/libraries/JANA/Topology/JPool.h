@@ -1,10 +1,34 @@
+
 // Copyright 2023, Jefferson Science Associates, LLC.
 // Subject to the terms in the LICENSE file found in the top-level directory.
 
 #pragma once
 #include <JANA/Utils/JCpuInfo.h>
+#include <JANA/Utils/JProcessorMapping.h>
 #include <JANA/JLogger.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <future>
 #include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+
+#ifndef JANA2_POOL_MAGAZINE_SIZE
+#define JANA2_POOL_MAGAZINE_SIZE 16
+#endif
+
+#ifndef JANA2_POOL_MAX_MAGAZINES
+#define JANA2_POOL_MAX_MAGAZINES 256
+#endif
+
+#ifndef JANA2_PAGE_BYTES
+#define JANA2_PAGE_BYTES 4096
+#endif
 
 
 class JPoolBase {
@@ -22,18 +46,168 @@ public:
       , m_limit_total_events_in_flight(limit_total_events_in_flight) {}
 
     virtual ~JPoolBase() = default;
+
+    /// Puts pools under one shared budget of (approximate) bytes in flight. Once the budget is used up, pops
+    /// and gets fail until enough items come back, which gives the event sources backpressure. A pool with
+    /// nothing in flight may always hand out one item, so that no level of the event hierarchy can be starved.
+    /// Must be called before any items are taken from the pools. Zero means unlimited.
+    static void share_byte_budget(const std::vector<JPoolBase*>& pools, size_t max_bytes_in_flight) {
+        for (JPoolBase* pool : pools) {
+            pool->m_max_bytes_in_flight = max_bytes_in_flight;
+            pool->m_budget_group = pools;
+        }
+    }
+
+    /// Estimated bytes held by this pool's items in flight: the item count times the average measured item size
+    size_t get_bytes_in_flight() const {
+        return m_items_in_flight.load(std::memory_order_relaxed) * m_bytes_per_item.load(std::memory_order_relaxed);
+    }
+
+    size_t get_bytes_per_item() const {
+        return m_bytes_per_item.load(std::memory_order_relaxed);
+    }
+
+    /// Called whenever an item comes back, so that idle workers (e.g. ones waiting to run a source) can be woken up
+    void set_push_notifier(std::function<void()> notifier) {
+        m_push_notifier = std::move(notifier);
+    }
+
+protected:
+
+    size_t m_max_bytes_in_flight = 0;                   // Zero means unlimited
+    std::vector<JPoolBase*> m_budget_group;             // All pools sharing m_max_bytes_in_flight, including this one
+    std::atomic<size_t> m_items_in_flight {0};          // Only tracked when there is a byte budget
+    std::atomic<size_t> m_bytes_per_item {0};           // Moving average of the sizes measured when items come back
+    std::function<void()> m_push_notifier;
+
+    /// Returns how many of requested_count items we may hand out without going over the byte budget
+    size_t get_budgeted_count(size_t requested_count) const {
+        size_t bytes_per_item = m_bytes_per_item.load(std::memory_order_relaxed);
+        if (m_max_bytes_in_flight == 0 || bytes_per_item == 0) {
+            return requested_count;  // No budget, or we don't know anything about item sizes yet
+        }
+        size_t total_bytes = 0;
+        for (JPoolBase* pool : m_budget_group) {
+            total_bytes += pool->get_bytes_in_flight();
+        }
+        size_t allowed_count = (total_bytes < m_max_bytes_in_flight) ? (m_max_bytes_in_flight - total_bytes) / bytes_per_item : 0;
+        if (allowed_count == 0 && m_items_in_flight.load(std::memory_order_relaxed) == 0) {
+            allowed_count = 1;
+        }
+        return std::min(requested_count, allowed_count);
+    }
+
+    /// Folds one measured item size into the moving average. Racing updates may get lost, which is fine for an estimate.
+    void record_item_bytes(size_t bytes) {
+        size_t average = m_bytes_per_item.load(std::memory_order_relaxed);
+        if (average == 0) {
+            average = bytes;
+        }
+        else {
+            average = average - average/8 + bytes/8;
+        }
+        m_bytes_per_item.store(std::max<size_t>(average, 1), std::memory_order_relaxed);
+    }
+
+    /// Every thread which touches a pool is given a small integer id, which it keeps until it exits.
+    /// Pools use it to index their per-thread magazines without any synchronization. Ids of exited threads
+    /// are recycled, so that they stay dense even when threads come and go.
+    static size_t get_thread_slot() {
+
+        struct SlotRegistry {
+            std::mutex mutex;
+            std::vector<size_t> free_slots;
+            size_t next_slot = 0;
+        };
+        static SlotRegistry registry;
+
+        struct SlotHolder {
+            size_t slot;
+            SlotHolder() {
+                std::lock_guard<std::mutex> lock(registry.mutex);
+                if (registry.free_slots.empty()) {
+                    slot = registry.next_slot++;
+                }
+                else {
+                    slot = registry.free_slots.back();
+                    registry.free_slots.pop_back();
+                }
+            }
+            ~SlotHolder() {
+                std::lock_guard<std::mutex> lock(registry.mutex);
+                registry.free_slots.push_back(slot);
+            }
+        };
+        static thread_local SlotHolder holder;
+        return holder.slot;
+    }
 };
 
+/// JPool recycles items (usually events) so that they don't need to be reallocated and reconfigured.
+///
+/// All pooled items live in one contiguous arena, with each location owning a contiguous, page-aligned slice of it.
+/// This means we can find the owning location of any item in O(1) from its address, and anything outside
+/// the arena must have been allocated on the heap (when limit_total_events_in_flight=false).
+///
+/// init(mapping) constructs and configures each location's slice on a thread pinned to one of that location's
+/// cpus. Under the usual first-touch policy, this puts each location's items (and, for JEventPool, everything
+/// the JFactorySets allocate up front) in that location's own NUMA domain. Plain init() does everything on
+/// the calling thread.
+///
+/// In front of each location's mutex-protected free list, each thread has a small magazine of free items.
+/// Recycling an item that belongs to the thread's current location goes into the magazine without taking
+/// any lock, and getting an item takes from the magazine first. Magazines exchange items with the shared
+/// free list in batches. At most half of each location's items may sit in magazines at any time. When a
+/// location's free list can't satisfy a get or pop, the taker drains that location's items out of the other
+/// threads' magazines, so that items parked by idle workers, or by workers that scale() retired, are never
+/// stranded. Each magazine has a busy flag, which its owner sets (uncontended) while using it, and which
+/// lets other threads drain it safely.
+///
+/// When limit_total_events_in_flight=false, the pool makes up for any shortfall by allocating overflow items on
+/// the heap. By default these are deleted as soon as they are returned. In elastic mode (see set_elastic()),
+/// they are kept in a secondary free list and reused instead, which avoids rebuilding e.g. a whole JFactorySet
+/// whenever demand spikes. Once no overflow item has been requested for a full quiet period, the free overflow
+/// items are deleted again, so that the pool shrinks back toward its original size. This is checked whenever
+/// items are taken or returned, so it also happens when every overflow item came back before the quiet period ended.
 template <typename T>
 class JPool : public JPoolBase {
 private:
     struct alignas(JANA2_CACHE_LINE_BYTES) LocalPool {
         std::mutex mutex;
         std::vector<T*> available_items;
-        std::vector<T> items;
+        std::atomic<size_t> cached_count {0};   // Number of this location's items currently in some magazine
     };
 
+    /// Heap-allocated items don't remember which location they came from, so they share one free list
+    struct alignas(JANA2_CACHE_LINE_BYTES) OverflowPool {
+        std::mutex mutex;
+        std::vector<T*> available_items;        // Only used in elastic mode
+        size_t live_count = 0;                  // Number of heap-allocated items, free or in flight
+        size_t high_water = 0;                  // Max live_count seen so far
+        // These let the regular get/put paths check whether there is anything to trim without taking the lock
+        std::atomic<size_t> available_count {0};                    // Mirrors available_items.size()
+        std::atomic<std::chrono::steady_clock::rep> last_demand {0};  // When an overflow item was last requested
+    };
+
+    struct alignas(JANA2_CACHE_LINE_BYTES) Magazine {
+        std::atomic<bool> is_busy {false};      // Held by the owning thread, or by a thread draining it
+        size_t location = 0;
+        size_t count = 0;
+        std::array<T*, JANA2_POOL_MAGAZINE_SIZE> items;
+    };
+
+    unsigned char* m_arena = nullptr;
+    size_t m_slice_bytes = 0;           // Distance between the starts of consecutive locations' slices
+    size_t m_constructed_count = 0;     // Number of locations whose slices have been constructed
+    size_t m_partial_count = 0;         // Items constructed so far in slice m_constructed_count, if that one failed
     std::unique_ptr<LocalPool[]> m_pools;
+    OverflowPool m_overflow;
+    std::unique_ptr<Magazine[]> m_magazines;
+    std::atomic<size_t> m_magazine_slot_count {0};  // One past the highest thread slot that has used a magazine
+    size_t m_magazine_size = 0;
+    size_t m_max_cached_count = 0;
+    bool m_elastic = false;
+    std::chrono::steady_clock::duration m_trim_quiet_period = std::chrono::seconds(5);
 
 public:
     JPool(size_t pool_size,
@@ -44,43 +218,217 @@ public:
         assert(m_pool_size > 0 || !m_limit_total_events_in_flight);
     }
 
-    virtual ~JPool() = default;
+    virtual ~JPool() {
+        for (T* item : m_overflow.available_items) {
+            delete item;
+        }
+        for (size_t j=0; j<m_constructed_count; ++j) {
+            T* slice = get_slice(j);
+            for (size_t i=0; i<m_pool_size; ++i) {
+                slice[i].~T();
+            }
+        }
+        if (m_partial_count != 0) {
+            T* slice = get_slice(m_constructed_count);
+            for (size_t i=0; i<m_partial_count; ++i) {
+                slice[i].~T();
+            }
+        }
+        if (m_arena != nullptr) {
+            ::operator delete(m_arena, std::align_val_t(JANA2_PAGE_BYTES));
+        }
+    }
 
+    JPool(const JPool&) = delete;
+    JPool& operator=(const JPool&) = delete;
+
+    /// Elastic mode keeps heap-allocated overflow items around for reuse, and trims them once nobody has needed
+    /// one for trim_quiet_period. Only has an effect when limit_total_events_in_flight=false.
+    void set_elastic(bool elastic, std::chrono::steady_clock::duration trim_quiet_period = std::chrono::seconds(5)) {
+        m_elastic = elastic;
+        m_trim_quiet_period = trim_quiet_period;
+    }
+
+    /// Constructs and configures every location's items on the calling thread
     void init() {
-        m_pools = std::unique_ptr<LocalPool[]>(new LocalPool[m_location_count]());
+        allocate();
+        for (size_t j=0; j<m_location_count; ++j) {
+            construct_slice(j);
+        }
+    }
 
+    /// Constructs and configures each location's items on a thread pinned to that location, so that they are
+    /// first-touched in the right memory domain. Locations are done one after another, so that configure_item()
+    /// never runs concurrently. Falls back to init() if the mapping doesn't know about our locations.
+    void init(const JProcessorMapping& mapping) {
+        if (!mapping.is_initialized() || mapping.get_loc_count() != m_location_count) {
+            init();
+            return;
+        }
+        allocate();
         for (size_t j=0; j<m_location_count; ++j) {
+            std::promise<void> pinned;
+            std::exception_ptr error;
+            std::thread worker([&, j]() {
+                pinned.get_future().wait();
+                try {
+                    construct_slice(j);
+                }
+                catch (...) {
+                    // E.g. a JException from configure_item(). Rethrown below, so that it reaches the caller of
+                    // init() just like it would from the plain init(), instead of terminating the program.
+                    error = std::current_exception();
+                }
+            });
+            JCpuInfo::PinThreadToCpu(&worker, mapping.get_loc_cpu_id(j));  // If this fails, we just lose locality
+            pinned.set_value();
+            worker.join();
+            if (error != nullptr) {
+                std::rethrow_exception(error);
+            }
+        }
+    }
 
-            m_pools[j].items = std::vector<T>(m_pool_size); // Default-construct everything in place
+private:
 
-            for (T& item : m_pools[j].items) {
-                configure_item(&item);
-                m_pools[j].available_items.push_back(&item);
-            }
+    T* get_slice(size_t location) {
+        return reinterpret_cast<T*>(m_arena + location * m_slice_bytes);
+    }
+
+    /// Reserves (but doesn't touch) the arena. Each slice starts on its own page so that first-touch can
+    /// place it independently of its neighbors.
+    void allocate() {
+        m_pools = std::unique_ptr<LocalPool[]>(new LocalPool[m_location_count]());
+        size_t item_bytes = m_pool_size * sizeof(T);
+        m_slice_bytes = ((item_bytes + JANA2_PAGE_BYTES - 1) / JANA2_PAGE_BYTES) * JANA2_PAGE_BYTES;
+        if (m_slice_bytes != 0) {
+            m_arena = static_cast<unsigned char*>(::operator new(m_slice_bytes * m_location_count, std::align_val_t(JANA2_PAGE_BYTES)));
         }
+        m_magazines = std::unique_ptr<Magazine[]>(new Magazine[JANA2_POOL_MAX_MAGAZINES]());
+        m_max_cached_count = m_pool_size / 2;
+        m_magazine_size = std::min<size_t>(JANA2_POOL_MAGAZINE_SIZE, m_max_cached_count);
     }
 
+    void construct_slice(size_t location) {
+        T* slice = get_slice(location);
+        for (size_t i=0; i<m_pool_size; ++i) {
+            T* item = new (&slice[i]) T();  // Default-construct everything in place
+            m_partial_count = i + 1;        // So that the destructor cleans up if configure_item() throws
+            configure_item(item);
+            m_pools[location].available_items.push_back(item);
+        }
+        m_constructed_count = location + 1;
+        m_partial_count = 0;
+    }
+
+public:
+
     virtual void configure_item(T*) {
     }
 
     virtual void release_item(T*) {
     }
 
+    /// Estimates the number of bytes an item is holding on to. Called when the item is returned, before
+    /// release_item(), and only if there is a byte budget (see share_byte_budget()).
+    virtual size_t measure_item(T*) {
+        return 0;
+    }
+
+    /// Returns the location whose slice of the arena contains item, or m_location_count if it was heap-allocated
+    size_t get_owning_location(T* item) const {
+        auto address = reinterpret_cast<const unsigned char*>(item);
+        if (m_arena == nullptr || address < m_arena || address >= m_arena + m_slice_bytes * m_location_count) {
+            return m_location_count;
+        }
+        size_t offset = static_cast<size_t>(address - m_arena);
+        if (offset % m_slice_bytes >= m_pool_size * sizeof(T)) {
+            return m_location_count;  // Page padding between slices. Nothing we handed out lives here.
+        }
+        return offset / m_slice_bytes;
+    }
+
+    /// Number of items currently parked in magazines for this location
+    size_t get_cached_count(size_t location=0) const {
+        return m_pools[location % m_location_count].cached_count.load(std::memory_order_relaxed);
+    }
+
+    /// Number of live heap-allocated items, free or in flight. Only tracked in elastic mode.
+    size_t get_overflow_count() {
+        std::lock_guard<std::mutex> lock(m_overflow.mutex);
+        return m_overflow.live_count;
+    }
+
+    /// The most heap-allocated items that have ever been alive at once. Only tracked in elastic mode.
+    size_t get_overflow_high_water() {
+        std::lock_guard<std::mutex> lock(m_overflow.mutex);
+        return m_overflow.high_water;
+    }
+
 
     T* get(size_t location=0) {
 
+        maybe_trim_overflow();
+        if (m_max_bytes_in_flight == 0) {
+            return get_item(location);
+        }
+        if (get_budgeted_count(1) == 0) {
+            return nullptr;
+        }
+        T* item = get_item(location);
+        if (item != nullptr) {
+            m_items_in_flight.fetch_add(1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+
+    void put(T* item, size_t location=0) {
+
         assert(m_pools != nullptr); // If you hit this, you forgot to call init().
-        LocalPool& pool = m_pools[location % m_location_count];
-        std::lock_guard<std::mutex> lock(pool.mutex);
 
+        if (m_max_bytes_in_flight != 0) {
+            record_item_bytes(measure_item(item));
+            m_items_in_flight.fetch_sub(1, std::memory_order_relaxed);
+        }
+        put_item(item, location);
+        maybe_trim_overflow();
+        if (m_push_notifier) m_push_notifier();
+    }
+
+private:
+
+    T* get_item(size_t location) {
+
+        assert(m_pools != nullptr); // If you hit this, you forgot to call init().
+        location = location % m_location_count;
+        LocalPool& pool = m_pools[location];
+
+        Magazine* mag = acquire_magazine(location);
+        if (mag != nullptr) {
+            if (mag->count == 0) {
+                refill_magazine(*mag, pool);
+            }
+            if (mag->count != 0) {
+                pool.cached_count.fetch_sub(1, std::memory_order_relaxed);
+                T* item = mag->items[--mag->count];
+                release_magazine(mag);
+                return item;
+            }
+            release_magazine(mag);
+        }
+
+        std::lock_guard<std::mutex> lock(pool.mutex);
         if (pool.available_items.empty()) {
+            T* item = nullptr;
+            if (drain_magazines(pool, location, &item, 1) == 1) {
+                return item;
+            }
             if (m_limit_total_events_in_flight) {
                 return nullptr;
             }
             else {
-                auto t = new T;
-                configure_item(t);
-                return t;
+                return take_overflow_item();
             }
         }
         else {
@@ -91,29 +439,42 @@ public:
     }
 
 
-    void put(T* item, size_t location=0) {
+    void put_item(T* item, size_t location) {
 
-        assert(m_pools != nullptr); // If you hit this, you forgot to call init().
-        
         // Do any necessary teardown within the item itself
         release_item(item);
 
-        // Consider each location starting with current one
-        for (size_t l = location; l<location+m_location_count; ++l) {
-            LocalPool& pool = m_pools[l % m_location_count];
-
-            // Check if item came from this location
-            if ((item >= &(pool.items[0])) && (item <= &(pool.items[m_pool_size-1]))) {
-                std::lock_guard<std::mutex> lock(pool.mutex);
-                pool.available_items.push_back(item);
-                return;
+        size_t owner = get_owning_location(item);
+        if (owner == m_location_count) {
+            // It was allocated on the heap
+            return_overflow_item(item);
+            return;
+        }
+        LocalPool& pool = m_pools[owner];
+
+        // Fast path: the item belongs to our own location, so it can stay in our magazine
+        if (owner == location % m_location_count) {
+            Magazine* mag = acquire_magazine(owner);
+            if (mag != nullptr) {
+                if (mag->count == m_magazine_size) {
+                    flush_magazine(*mag, pool, m_magazine_size / 2);
+                }
+                if (pool.cached_count.fetch_add(1, std::memory_order_relaxed) < m_max_cached_count) {
+                    mag->items[mag->count++] = item;
+                    release_magazine(mag);
+                    return;
+                }
+                pool.cached_count.fetch_sub(1, std::memory_order_relaxed);
+                release_magazine(mag);
             }
-
         }
-        // Otherwise it was allocated on the heap
-        delete item;
+
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        pool.available_items.push_back(item);
     }
 
+public:
+
     // TODO: This is wrong. Do we use this anywhere?
     size_t size() { return m_pool_size; }
 
@@ -122,13 +483,31 @@ public:
 
         assert(m_pools != nullptr); // If you hit this, you forgot to call init().
 
-        LocalPool& pool = m_pools[location % m_location_count];
+        location = location % m_location_count;
+        LocalPool& pool = m_pools[location];
         std::lock_guard<std::mutex> lock(pool.mutex);
-
-        if (m_limit_total_events_in_flight && pool.available_items.size() < count) {
+        Magazine* mag = acquire_magazine(location);
+        struct Releaser {
+            JPool* pool; Magazine* mag;
+            ~Releaser() { pool->release_magazine(mag); }
+        } releaser {this, mag};
+
+        size_t cached_count = (mag == nullptr) ? 0 : mag->count;
+        if (m_limit_total_events_in_flight && pool.available_items.size() + cached_count < count) {
+            return false;
+        }
+        else if (get_budgeted_count(count) < count) {
             return false;
         }
         else {
+            if (m_max_bytes_in_flight != 0) {
+                m_items_in_flight.fetch_add(count, std::memory_order_relaxed);
+            }
+            while (count > 0 && mag != nullptr && mag->count != 0) {
+                dest.push_back(mag->items[--mag->count]);
+                pool.cached_count.fetch_sub(1, std::memory_order_relaxed);
+                count -= 1;
+            }
             while (count > 0 && !pool.available_items.empty()) {
                 T* t = pool.available_items.back();
                 pool.available_items.pop_back();
@@ -136,9 +515,7 @@ public:
                 count -= 1;
             }
             while (count > 0) {
-                auto t = new T;
-                configure_item(t);
-                dest.push_back(t);
+                dest.push_back(take_overflow_item());
                 count -= 1;
             }
             return true;
@@ -155,55 +532,214 @@ public:
 
     size_t pop(T** dest, size_t min_count, size_t max_count, size_t location=0) {
 
+        maybe_trim_overflow();
+        if (m_max_bytes_in_flight == 0) {
+            return pop_items(dest, min_count, max_count, location);
+        }
+        max_count = get_budgeted_count(max_count);
+        if (max_count < min_count || max_count == 0) {
+            return 0;
+        }
+        size_t count = pop_items(dest, min_count, max_count, location);
+        m_items_in_flight.fetch_add(count, std::memory_order_relaxed);
+        return count;
+    }
+
+    void push(T** source, size_t count, size_t location=0) {
+        for (size_t i=0; i<count; ++i) {
+            put(source[i], location);
+            source[i] = nullptr;
+        }
+    }
+
+private:
+
+    size_t pop_items(T** dest, size_t min_count, size_t max_count, size_t location) {
+
         assert(m_pools != nullptr); // If you hit this, you forgot to call init().
 
-        LocalPool& pool = m_pools[location % m_location_count];
+        location = location % m_location_count;
+        LocalPool& pool = m_pools[location];
+
+        // Take whatever we can from our magazine without locking
+        size_t count = 0;
+        Magazine* mag = acquire_magazine(location);
+        if (mag != nullptr) {
+            while (count < max_count && mag->count != 0) {
+                dest[count++] = mag->items[--mag->count];
+            }
+            release_magazine(mag);
+            pool.cached_count.fetch_sub(count, std::memory_order_relaxed);
+            if (count == max_count) return count;
+        }
+
         std::lock_guard<std::mutex> lock(pool.mutex);
 
         size_t available_count = pool.available_items.size();
-
-        if (m_limit_total_events_in_flight && available_count < min_count) {
-            // Exit immmediately if we can't reach the minimum
-            return 0;
+        if (count + available_count < min_count) {
+            count += drain_magazines(pool, location, dest + count, min_count - count - available_count);
         }
-        if (m_limit_total_events_in_flight) {
-            // Return as many as we can. We aren't allowed to create any more
-            size_t count = std::min(available_count, max_count);
+
+        if (m_limit_total_events_in_flight && count + available_count < min_count) {
+            // Exit immmediately if we can't reach the minimum. Hand back anything we took from the magazine.
             for (size_t i=0; i<count; ++i) {
-                T* t = pool.available_items.back();
-                pool.available_items.pop_back();
-                dest[i] = t;
+                pool.available_items.push_back(dest[i]);
+                dest[i] = nullptr;
             }
-            return count;
+            return 0;
         }
-        else {
+
+        // Return as many as we can
+        size_t target_count = std::min(count + available_count, max_count);
+        for (; count<target_count; ++count) {
+            T* t = pool.available_items.back();
+            pool.available_items.pop_back();
+            dest[count] = t;
+        }
+        if (!m_limit_total_events_in_flight) {
             // Try to minimize number of allocations, as long as we meet min_count
-            size_t count = std::min(available_count, max_count);
-            size_t i=0;
-            for (i=0; i<count; ++i) {
-                // Pop the items already in the pool
-                T* t = pool.available_items.back();
-                pool.available_items.pop_back();
-                dest[i] = t;
+            for (; count<min_count; ++count) {
+                dest[count] = take_overflow_item();
             }
-            for (; i<min_count; ++i) {
-                // If we haven't reached our min count yet, allocate just enough to reach it
-                auto t = new T;
-                configure_item(t);
-                dest[i] = t;
+        }
+        return count;
+    }
+
+    /// Returns the calling thread's magazine, marked busy, if it may be used for location, or nullptr if not.
+    /// A magazine only ever holds items from one location. It can switch locations once it is empty.
+    /// Every non-null result has to be handed back to release_magazine().
+    Magazine* acquire_magazine(size_t location) {
+        if (m_magazine_size == 0) return nullptr;
+        size_t slot = get_thread_slot();
+        if (slot >= JANA2_POOL_MAX_MAGAZINES) return nullptr;
+        size_t slot_count = m_magazine_slot_count.load(std::memory_order_relaxed);
+        while (slot_count <= slot && !m_magazine_slot_count.compare_exchange_weak(slot_count, slot + 1)) {}
+        Magazine& mag = m_magazines[slot];
+        if (mag.is_busy.exchange(true, std::memory_order_acquire)) {
+            return nullptr;  // Another thread is draining it right now
+        }
+        if (mag.location != location) {
+            if (mag.count != 0) {
+                release_magazine(&mag);
+                return nullptr;
             }
-            return i;
+            mag.location = location;
         }
+        return &mag;
     }
 
-    void push(T** source, size_t count, size_t location=0) {
+    void release_magazine(Magazine* mag) {
+        if (mag != nullptr) {
+            mag->is_busy.store(false, std::memory_order_release);
+        }
+    }
+
+    /// Takes up to max_count of location's items out of any thread's magazine, skipping magazines that are busy.
+    /// Must be called while holding pool.mutex.
+    size_t drain_magazines(LocalPool& pool, size_t location, T** dest, size_t max_count) {
+        if (max_count == 0 || pool.cached_count.load(std::memory_order_relaxed) == 0) return 0;
+        size_t count = 0;
+        size_t slot_count = m_magazine_slot_count.load(std::memory_order_relaxed);
+        for (size_t slot=0; slot<slot_count && count<max_count; ++slot) {
+            Magazine& mag = m_magazines[slot];
+            if (mag.is_busy.exchange(true, std::memory_order_acquire)) continue;
+            if (mag.location == location) {
+                while (count < max_count && mag.count != 0) {
+                    dest[count++] = mag.items[--mag.count];
+                }
+            }
+            mag.is_busy.store(false, std::memory_order_release);
+        }
+        pool.cached_count.fetch_sub(count, std::memory_order_relaxed);
+        return count;
+    }
+
+    /// Moves up to half a magazine's worth of items from the shared free list, taking the lock once
+    void refill_magazine(Magazine& mag, LocalPool& pool) {
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        size_t count = std::min(pool.available_items.size(), std::max<size_t>(m_magazine_size / 2, 1));
+        size_t cached_count = pool.cached_count.fetch_add(count, std::memory_order_relaxed);
+        if (cached_count + count > m_max_cached_count) {
+            size_t excess = std::min(count, cached_count + count - m_max_cached_count);
+            pool.cached_count.fetch_sub(excess, std::memory_order_relaxed);
+            count -= excess;
+        }
         for (size_t i=0; i<count; ++i) {
-            put(source[i], location);
-            source[i] = nullptr;
+            mag.items[mag.count++] = pool.available_items.back();
+            pool.available_items.pop_back();
         }
     }
-};
 
+    /// Reuses a free overflow item if we have one, otherwise allocates.
+    T* take_overflow_item() {
+        if (!m_elastic) {
+            auto t = new T;
+            configure_item(t);
+            return t;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_overflow.mutex);
+            m_overflow.last_demand.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+            if (!m_overflow.available_items.empty()) {
+                T* t = m_overflow.available_items.back();
+                m_overflow.available_items.pop_back();
+                m_overflow.available_count.store(m_overflow.available_items.size(), std::memory_order_relaxed);
+                return t;
+            }
+            m_overflow.live_count += 1;
+            m_overflow.high_water = std::max(m_overflow.high_water, m_overflow.live_count);
+        }
+        auto t = new T;
+        configure_item(t);
+        return t;
+    }
+
+    /// Keeps a heap-allocated item for reuse, unless we're not elastic. put() trims it right away if demand has
+    /// already been quiet for long enough.
+    void return_overflow_item(T* item) {
+        if (!m_elastic) {
+            delete item;
+            return;
+        }
+        std::lock_guard<std::mutex> lock(m_overflow.mutex);
+        m_overflow.available_items.push_back(item);
+        m_overflow.available_count.store(m_overflow.available_items.size(), std::memory_order_relaxed);
+    }
+
+    bool is_overflow_quiet() const {
+        auto last_demand = std::chrono::steady_clock::duration(m_overflow.last_demand.load(std::memory_order_relaxed));
+        return std::chrono::steady_clock::now().time_since_epoch() - last_demand >= m_trim_quiet_period;
+    }
+
+    /// Deletes the free overflow items once no overflow item has been requested for the quiet period. When there
+    /// are none, which is the steady state, this costs a single relaxed load.
+    void maybe_trim_overflow() {
+        if (!m_elastic || m_overflow.available_count.load(std::memory_order_relaxed) == 0) return;
+        if (!is_overflow_quiet()) return;
+        std::vector<T*> trimmed_items;
+        {
+            std::lock_guard<std::mutex> lock(m_overflow.mutex);
+            if (!is_overflow_quiet()) return;  // Somebody took an overflow item in the meantime
+            trimmed_items.swap(m_overflow.available_items);
+            m_overflow.available_count.store(0, std::memory_order_relaxed);
+            m_overflow.live_count -= trimmed_items.size();
+        }
+        // Delete outside the lock, since destroying e.g. a JFactorySet can take a while
+        for (T* t : trimmed_items) {
+            delete t;
+        }
+    }
+
+    /// Moves count items from the magazine back to the shared free list, taking the lock once
+    void flush_magazine(Magazine& mag, LocalPool& pool, size_t count) {
+        count = std::min(count, mag.count);
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        for (size_t i=0; i<count; ++i) {
+            pool.available_items.push_back(mag.items[--mag.count]);
+        }
+        pool.cached_count.fetch_sub(count, std::memory_order_relaxed);
+    }
+};
 
 
 
@@ -0,0 +1,280 @@
+// Copyright 2024, Jefferson Science Associates, LLC.
+// Subject to the terms in the LICENSE file found in the top-level directory.
+
+#pragma once
+#include <JANA/Topology/JMailbox.h>
+#include <atomic>
+#include <thread>
+
+/// JRingMailbox is a drop-in alternative to JMailbox's mutex-and-deque LocalQueue. Each location
+/// owns a preallocated, power-of-two MPMC ring buffer (Vyukov-style, with a sequence number per slot),
+/// so that pushes and pops are a handful of atomic operations instead of a lock acquisition.
+///
+/// It keeps the same contract that PlaceRef::pull/push rely on:
+///   - reserve() never hands out more space than threshold - size - reserved_count
+///   - pop_and_reserve() reserves space for the items it pops, so that they can always be pushed back
+///   - push_and_unreserve() always succeeds when the caller reserved first
+///   - pop() and pop_and_reserve() return 0 unless they can satisfy min_requested_count. They claim a whole
+///     range of published items with a single CAS on head, so they never take items only to hand them back,
+///     and the queue stays in FIFO order per location.
+///
+/// Unlike JMailbox, the threshold is a hard bound: the ring is sized to the next power of two
+/// above the threshold at construction, and set_threshold() can't grow past that. Pops never return
+/// Status::Congested, because there is no lock to contend on.
+///
+/// Select this implementation for the event queues with `jana:queue_impl=ring`.
+
+template <typename T>
+class JRingMailbox : public JMailbox<T> {
+
+    using Status = typename JMailbox<T>::Status;
+
+    struct Slot {
+        std::atomic<size_t> sequence;
+        T item;
+    };
+
+    struct alignas(JANA2_CACHE_LINE_BYTES) LocalRing {
+        alignas(JANA2_CACHE_LINE_BYTES) std::atomic<size_t> head {0};   // Next position to dequeue from
+        alignas(JANA2_CACHE_LINE_BYTES) std::atomic<size_t> tail {0};   // Next position to enqueue into
+        alignas(JANA2_CACHE_LINE_BYTES) std::atomic<size_t> reserved_count {0};
+        std::unique_ptr<Slot[]> slots;
+        size_t mask = 0;
+    };
+
+    std::unique_ptr<LocalRing[]> m_rings;
+    size_t m_slot_count;
+
+public:
+
+    /// threshold: the (hard) maximum number of items in each location's ring at any time
+    /// locations_count: the number of locations. More locations = better NUMA performance, worse load balancing
+    /// enable_work_stealing: allow events to cross locations only when no other work is available.
+    JRingMailbox(size_t threshold=100, size_t locations_count=1, bool enable_work_stealing=false)
+        : JMailbox<T>(threshold, locations_count, enable_work_stealing) {
+
+        m_slot_count = 1;
+        while (m_slot_count < threshold) m_slot_count <<= 1;
+
+        m_rings = std::unique_ptr<LocalRing[]>(new LocalRing[locations_count]);
+        for (size_t loc=0; loc<locations_count; ++loc) {
+            LocalRing& ring = m_rings[loc];
+            ring.slots = std::unique_ptr<Slot[]>(new Slot[m_slot_count]);
+            ring.mask = m_slot_count - 1;
+            for (size_t i=0; i<m_slot_count; ++i) {
+                ring.slots[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    ~JRingMailbox() override = default;
+
+    /// The ring can't be resized while workers are using it, so the threshold is clamped to the slot count
+    void set_threshold(size_t threshold) override {
+        this->m_capacity = std::min(threshold, m_slot_count);
+    }
+
+    size_t get_slot_count() const { return m_slot_count; }
+
+    size_t size() override {
+        size_t result = 0;
+        for (size_t i=0; i<this->m_locations_count; ++i) {
+            result += occupancy(m_rings[i]);
+        }
+        return result;
+    }
+
+    size_t size(size_t location_id) override {
+        return occupancy(m_rings[location_id]);
+    }
+
+    size_t reserve(size_t requested_count, size_t location_id = 0) override {
+        return reserve(1, requested_count, location_id);
+    }
+
+    Status push(std::vector<T>& buffer, size_t reserved_count = 0, size_t location_id = 0) override {
+        LocalRing& ring = m_rings[location_id];
+        for (T& t : buffer) {
+            enqueue(ring, std::move(t));
+        }
+        buffer.clear();
+        ring.reserved_count.fetch_sub(reserved_count);
+        this->notify_push();
+        if (occupancy(ring) > this->m_capacity) {
+            return Status::Full;
+        }
+        return Status::Ready;
+    }
+
+    Status pop(std::vector<T>& buffer, size_t requested_count, size_t location_id = 0) override {
+        LocalRing& ring = m_rings[location_id];
+        T item;
+        while (buffer.size() < requested_count && try_dequeue(ring, item)) {
+            buffer.push_back(std::move(item));
+        }
+        auto size = occupancy(ring);
+        if (size >= this->m_capacity) {
+            return Status::Full;
+        }
+        else if (size != 0) {
+            return Status::Ready;
+        }
+        return Status::Empty;
+    }
+
+    Status pop(T& item, bool& success, size_t location_id = 0) override {
+        LocalRing& ring = m_rings[location_id];
+        success = try_dequeue(ring, item);
+        if (success && occupancy(ring) > 0) {
+            return Status::Ready;
+        }
+        return Status::Empty;
+    }
+
+    bool try_push(T* buffer, size_t count, size_t location_id = 0) override {
+        if (reserve(count, count, location_id) == 0 && count != 0) return false;
+        push_and_unreserve(buffer, count, count, location_id);
+        return true;
+    }
+
+    void push_and_unreserve(T* buffer, size_t count, size_t reserved_count = 0, size_t location_id = 0) override {
+        LocalRing& ring = m_rings[location_id];
+        assert(reserved_count <= ring.reserved_count.load());
+        for (size_t i=0; i<count; ++i) {
+            enqueue(ring, std::move(buffer[i]));
+            buffer[i] = T{};
+        }
+        // Release the reservation only after the items are visible, so that size+reserved never undercounts
+        ring.reserved_count.fetch_sub(reserved_count);
+        if (count != 0) this->notify_push();
+    }
+
+    size_t pop(T* buffer, size_t min_requested_count, size_t max_requested_count, size_t location_id = 0) override {
+        LocalRing& ring = m_rings[location_id];
+        if (occupancy(ring) < min_requested_count) return 0;
+        return dequeue_range(ring, buffer, min_requested_count, max_requested_count, false);
+    }
+
+    size_t pop_and_reserve(T* buffer, size_t min_requested_count, size_t max_requested_count, size_t location_id = 0) override {
+        LocalRing& ring = m_rings[location_id];
+        if (occupancy(ring) < min_requested_count) {
+            return this->steal_and_reserve(buffer, min_requested_count, max_requested_count, location_id);
+        }
+        return dequeue_range(ring, buffer, min_requested_count, max_requested_count, true);
+    }
+
+    size_t reserve(size_t min_requested_count, size_t max_requested_count, size_t location_id) override {
+        LocalRing& ring = m_rings[location_id];
+        size_t reserved = ring.reserved_count.load();
+        while (true) {
+            size_t occupied = occupancy(ring) + reserved;
+            size_t available_count = (occupied < this->m_capacity) ? this->m_capacity - occupied : 0;
+            size_t count = std::min(available_count, max_requested_count);
+            if (count < min_requested_count) {
+                return 0;
+            }
+            if (ring.reserved_count.compare_exchange_weak(reserved, reserved + count)) {
+                return count;
+            }
+        }
+    }
+
+    void unreserve(size_t reserved_count, size_t location_id) override {
+        LocalRing& ring = m_rings[location_id];
+        assert(reserved_count <= ring.reserved_count.load());
+        ring.reserved_count.fetch_sub(reserved_count);
+    }
+
+private:
+
+    /// Reads head before tail. Since tail only grows and head never passes tail, this can't underflow.
+    size_t occupancy(LocalRing& ring) {
+        size_t head = ring.head.load(std::memory_order_acquire);
+        size_t tail = ring.tail.load(std::memory_order_acquire);
+        return tail - head;
+    }
+
+    bool try_enqueue(LocalRing& ring, T&& item) {
+        size_t pos = ring.tail.load(std::memory_order_relaxed);
+        Slot* slot;
+        while (true) {
+            slot = &ring.slots[pos & ring.mask];
+            size_t seq = slot->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (ring.tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            }
+            else if (diff < 0) {
+                return false; // Ring is physically full
+            }
+            else {
+                pos = ring.tail.load(std::memory_order_relaxed);
+            }
+        }
+        slot->item = std::move(item);
+        slot->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Pushes may not fail. If the caller didn't reserve and the ring is physically full, we wait for a consumer.
+    void enqueue(LocalRing& ring, T&& item) {
+        while (!try_enqueue(ring, std::move(item))) {
+            std::this_thread::yield();
+        }
+    }
+
+    /// Claims between min_count and max_count consecutive published items starting at head, with one CAS, and
+    /// moves them into buffer. Returns 0, taking nothing, if fewer than min_count are ready. With `reserve`, the
+    /// space for exactly the claimed items is reserved before head moves, so that a concurrent reserve() never
+    /// sees them as gone.
+    size_t dequeue_range(LocalRing& ring, T* buffer, size_t min_count, size_t max_count, bool reserve) {
+        size_t pos = ring.head.load(std::memory_order_relaxed);
+        size_t count;
+        while (true) {
+            count = 0;
+            while (count < max_count) {
+                size_t seq = ring.slots[(pos + count) & ring.mask].sequence.load(std::memory_order_acquire);
+                if (seq != pos + count + 1) break;  // Not published yet, or already claimed by another consumer
+                count++;
+            }
+            if (count < min_count || count == 0) {
+                size_t current = ring.head.load(std::memory_order_relaxed);
+                if (current == pos) return 0;  // Genuinely not enough items
+                pos = current;                 // Head moved under us, so our scan was stale
+                continue;
+            }
+            if (reserve) ring.reserved_count.fetch_add(count);
+            if (ring.head.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed)) break;
+            if (reserve) ring.reserved_count.fetch_sub(count);
+        }
+        for (size_t i=0; i<count; ++i) {
+            Slot& slot = ring.slots[(pos + i) & ring.mask];
+            buffer[i] = std::move(slot.item);
+            slot.sequence.store(pos + i + ring.mask + 1, std::memory_order_release);
+        }
+        return count;
+    }
+
+    bool try_dequeue(LocalRing& ring, T& item) {
+        size_t pos = ring.head.load(std::memory_order_relaxed);
+        Slot* slot;
+        while (true) {
+            slot = &ring.slots[pos & ring.mask];
+            size_t seq = slot->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (ring.head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            }
+            else if (diff < 0) {
+                return false; // Ring is empty
+            }
+            else {
+                pos = ring.head.load(std::memory_order_relaxed);
+            }
+        }
+        item = std::move(slot->item);
+        slot->sequence.store(pos + ring.mask + 1, std::memory_order_release);
+        return true;
+    }
+};
+
@@ -36,10 +36,12 @@ struct JSubeventProcessor {
 template <typename SubeventT>
 struct SubeventWrapper {
 
-    std::shared_ptr<JEvent>* parent;
-    SubeventT* data;
-    size_t id;
-    size_t total;
+    std::shared_ptr<JEvent>* parent = nullptr;
+    SubeventT* data = nullptr;
+    size_t id = 0;
+    size_t total = 0;
+
+    SubeventWrapper() = default;  // JMailbox needs to be able to clear its buffer slots
 
     SubeventWrapper(std::shared_ptr<JEvent>* parent, SubeventT* data, size_t id, size_t total)
     : parent(std::move(parent))
@@ -7,9 +7,12 @@
 
 #include "JEventSourceArrow.h"
 #include "JEventProcessorArrow.h"
+#include "JEventReduceArrow.h"
+#include "JEventReorderArrow.h"
 #include "JEventMapArrow.h"
 #include "JUnfoldArrow.h"
 #include "JFoldArrow.h"
+#include "JRingMailbox.h"
 #include <JANA/Utils/JTablePrinter.h>
 
 
@@ -85,15 +88,38 @@ void JTopologyBuilder::set_configure_fn(std::function<void(JTopologyBuilder&)> c
     m_configure_topology = std::move(configure_fn);
 }
 
+EventQueue* JTopologyBuilder::create_event_queue() {
+    if (m_queue_impl == "ring") {
+        return new JRingMailbox<Event*>(m_event_queue_threshold, mapping.get_loc_count(), m_enable_stealing);
+    }
+    return new EventQueue(m_event_queue_threshold, mapping.get_loc_count(), m_enable_stealing);
+}
+
+/// Event pools get one location per location in the processor mapping, so that events can stay in their
+/// own memory domain. jana:event_pool_size is split evenly among the locations.
+JEventPool* JTopologyBuilder::create_event_pool(JEventLevel level) {
+    size_t pool_size_per_location = (m_event_pool_size + m_location_count - 1) / m_location_count;
+    auto pool = new JEventPool(m_components,
+                               pool_size_per_location,
+                               m_location_count,
+                               m_limit_total_events_in_flight,
+                               level);
+    pool->set_elastic(m_event_pool_elastic, std::chrono::milliseconds(m_event_pool_trim_ms));
+    if (m_event_pool_first_touch) {
+        pool->init(mapping);
+    }
+    else {
+        pool->init();
+    }
+    return pool;
+}
+
 void JTopologyBuilder::create_topology() {
     mapping.initialize(static_cast<JProcessorMapping::AffinityStrategy>(m_affinity),
                        static_cast<JProcessorMapping::LocalityStrategy>(m_locality));
+    m_location_count = mapping.get_loc_count();
 
-    event_pool = new JEventPool(m_components,
-                                m_event_pool_size,
-                                m_location_count,
-                                m_limit_total_events_in_flight);
-    event_pool->init();
+    event_pool = create_event_pool(JEventLevel::PhysicsEvent);
 
     if (m_configure_topology) {
         m_configure_topology(*this);
@@ -103,10 +129,14 @@ void JTopologyBuilder::create_topology() {
         attach_top_level(JEventLevel::Run);
         LOG_INFO(GetLogger()) << "Arrow topology is:\n" << print_topology() << LOG_END;
     }
+    if (m_max_bytes_in_flight != 0) {
+        JPoolBase::share_byte_budget(pools, m_max_bytes_in_flight);
+    }
     int id=0;
     for (auto* queue : queues) {
         queue->set_logger(m_queue_logger);
         queue->set_id(id);
+        queue->set_processor_mapping(mapping);
         id += 1;
     }
     for (auto* arrow : arrows) {
@@ -135,18 +165,39 @@ void JTopologyBuilder::acquire_services(JServiceLocator *sl) {
     m_params->SetDefaultParameter("jana:limit_total_events_in_flight", m_limit_total_events_in_flight,
                                     "Controls whether the event pool is allowed to automatically grow beyond jana:event_pool_size")
             ->SetIsAdvanced(true);
+    m_params->SetDefaultParameter("jana:event_pool_elastic", m_event_pool_elastic,
+                                    "When jana:limit_total_events_in_flight=false, keep events allocated beyond jana:event_pool_size for reuse instead of deleting them right away")
+            ->SetIsAdvanced(true);
+    m_params->SetDefaultParameter("jana:event_pool_trim_ms", m_event_pool_trim_ms,
+                                    "With jana:event_pool_elastic, delete extra events once none have been needed for this many milliseconds")
+            ->SetIsAdvanced(true);
+    m_params->SetDefaultParameter("jana:max_bytes_in_flight", m_max_bytes_in_flight,
+                                    "Approximate memory budget for all in-flight events, estimated from their factories' GetMemoryUsage(). Sources get backpressure when it is exceeded. 0=unlimited")
+            ->SetIsAdvanced(true);
+    m_params->SetDefaultParameter("jana:event_pool_first_touch", m_event_pool_first_touch,
+                                    "Construct each location's events on a thread pinned to that location, so that their memory lands in the right NUMA domain. Only matters when jana:locality != 0")
+            ->SetIsAdvanced(true);
     m_params->SetDefaultParameter("jana:event_queue_threshold", m_event_queue_threshold,
                                     "Max number of events allowed on the main event queue. Higher => Better load balancing; Lower => Fewer events in flight")
             ->SetIsAdvanced(true);
     m_params->SetDefaultParameter("jana:event_source_chunksize", m_event_source_chunksize,
                                     "Max number of events that a JEventSource may enqueue at once. Higher => less queue contention; Lower => better load balancing")
             ->SetIsAdvanced(true);
+    m_params->SetDefaultParameter("jana:max_open_sources", m_max_open_sources,
+                                    "Max number of JEventSources at the same level that are read concurrently, each by a different worker. 1 => Read one source after another")
+            ->SetIsAdvanced(true);
     m_params->SetDefaultParameter("jana:event_processor_chunksize", m_event_processor_chunksize,
                                     "Max number of events that the JEventProcessors may dequeue at once. Higher => less queue contention; Lower => better load balancing")
             ->SetIsAdvanced(true);
     m_params->SetDefaultParameter("jana:enable_stealing", m_enable_stealing,
                                     "Enable work stealing. Improves load balancing when jana:locality != 0; otherwise does nothing.")
             ->SetIsAdvanced(true);
+    m_params->SetDefaultParameter("jana:queue_impl", m_queue_impl,
+                                    "Event queue implementation. 'deque'=Mutex-protected deque per location. 'ring'=Preallocated lock-free ring buffer per location, bounded by jana:event_queue_threshold")
+            ->SetIsAdvanced(true);
+    if (m_queue_impl != "deque" && m_queue_impl != "ring") {
+        throw JException("Invalid value for jana:queue_impl: '%s'. Expected 'deque' or 'ring'", m_queue_impl.c_str());
+    }
     m_params->SetDefaultParameter("jana:affinity", m_affinity,
                                     "Constrain worker thread CPU affinity. 0=Let the OS decide. 1=Avoid extra memory movement at the expense of using hyperthreads. 2=Avoid hyperthreads at the expense of extra memory movement")
             ->SetIsAdvanced(true);
@@ -166,12 +217,7 @@ void JTopologyBuilder::attach_lower_level(JEventLevel current_level, JUnfoldArro
 
     LOG_DEBUG(GetLogger()) << "JTopologyBuilder: Attaching components at lower level = " << current_level << LOG_END;
     
-    JEventPool* pool = new JEventPool(m_components,
-                                        m_event_pool_size,
-                                        m_location_count,
-                                        m_limit_total_events_in_flight, 
-                                        current_level);
-    pool->init();
+    JEventPool* pool = create_event_pool(current_level);
     pools.push_back(pool); // Transfers ownership
 
 
@@ -205,30 +251,85 @@ void JTopologyBuilder::attach_lower_level(JEventLevel current_level, JUnfoldArro
         throw JException("For now we require you to provide at least one JEventProcessor");
     }
 
-    auto q1 = new EventQueue(m_event_queue_threshold, mapping.get_loc_count(), m_enable_stealing);
+    auto q1 = create_event_queue();
     queues.push_back(q1);
 
-    auto q2 = new EventQueue(m_event_queue_threshold, mapping.get_loc_count(), m_enable_stealing);
+    auto q2 = create_event_queue();
     queues.push_back(q2);
 
-    auto* proc_arrow = new JEventProcessorArrow(ss.str()+"Tap", q1, q2, nullptr);
-    arrows.push_back(proc_arrow);
-    proc_arrow->set_chunksize(m_event_processor_chunksize);
-    proc_arrow->set_logger(m_arrow_logger);
-    if (found_sink) {
-        proc_arrow->set_is_sink(false);
-    }
-
     for (auto proc: procs_at_level) {
-        proc_arrow->add_processor(proc);
+        if (proc->AreEventsOrdered()) {
+            LOG_WARN(GetLogger()) << "JEventProcessor '" << proc->GetTypeName() << "' asked for ordered events, but ordering is only supported at the top level. Ignoring." << LOG_END;
+        }
     }
+    auto proc_arrows = attach_processors(ss.str(), procs_at_level, q1, q2, nullptr, !found_sink, false);
 
     parent_unfolder->attach_child_in(pool);
     parent_unfolder->attach_child_out(q1);
     parent_folder->attach_child_in(q2);
     parent_folder->attach_child_out(pool);
-    parent_unfolder->attach(proc_arrow);
-    proc_arrow->attach(parent_folder);
+    parent_unfolder->attach(proc_arrows.first);
+    proc_arrows.second->attach(parent_folder);
+}
+
+
+std::pair<JArrow*, JArrow*> JTopologyBuilder::attach_processors(const std::string& level_str,
+                                                                const std::vector<JEventProcessor*>& procs,
+                                                                JMailbox<std::shared_ptr<JEvent>*>* input_queue,
+                                                                JMailbox<std::shared_ptr<JEvent>*>* output_queue,
+                                                                JEventPool* pool,
+                                                                bool is_sink,
+                                                                bool allow_ordering) {
+
+    // Without any processors, the tap arrow alone forwards the events
+    auto* tap_output = procs.empty() ? output_queue : create_event_queue();
+    auto* tap_arrow = new JEventProcessorArrow(level_str+"Tap", input_queue, tap_output, procs.empty() ? pool : nullptr);
+    arrows.push_back(tap_arrow);
+    tap_arrow->set_chunksize(m_event_processor_chunksize);
+    tap_arrow->set_logger(m_arrow_logger);
+    tap_arrow->set_is_sink(procs.empty() && is_sink);
+    for (auto proc: procs) {
+        tap_arrow->add_processor(proc);
+    }
+    if (procs.empty()) {
+        return {tap_arrow, tap_arrow};
+    }
+    queues.push_back(tap_output);
+
+    JArrow* last_arrow = tap_arrow;
+    auto* reduce_input = tap_output;
+    for (size_t i=0; i<procs.size(); ++i) {
+        bool is_last = (i+1 == procs.size());
+        auto* reduce_output = is_last ? output_queue : create_event_queue();
+        if (!is_last) queues.push_back(reduce_output);
+
+        if (allow_ordering && procs[i]->AreEventsOrdered()) {
+            // The reorder buffer holds at most as many events as a queue, so that it is throttled the same way
+            auto* ordered_queue = create_event_queue();
+            queues.push_back(ordered_queue);
+            auto* reorder_arrow = new JEventReorderArrow(level_str+"Reorder:"+procs[i]->GetTypeName(), reduce_input,
+                                                         ordered_queue, m_event_queue_threshold);
+            arrows.push_back(reorder_arrow);
+            reorder_arrow->set_chunksize(m_event_processor_chunksize);
+            reorder_arrow->set_logger(m_arrow_logger);
+
+            last_arrow->attach(reorder_arrow);
+            last_arrow = reorder_arrow;
+            reduce_input = ordered_queue;
+        }
+
+        auto* reduce_arrow = new JEventReduceArrow(level_str+"Reduce:"+procs[i]->GetTypeName(), procs[i], reduce_input,
+                                                   reduce_output, (is_last && output_queue == nullptr) ? pool : nullptr);
+        arrows.push_back(reduce_arrow);
+        reduce_arrow->set_chunksize(m_event_processor_chunksize);
+        reduce_arrow->set_logger(m_arrow_logger);
+        reduce_arrow->set_is_sink(is_last && is_sink);
+
+        last_arrow->attach(reduce_arrow);
+        last_arrow = reduce_arrow;
+        reduce_input = reduce_output;
+    }
+    return {tap_arrow, last_arrow};
 }
 
 
@@ -258,12 +359,7 @@ void JTopologyBuilder::attach_top_level(JEventLevel current_level) {
     LOG_DEBUG(GetLogger()) << "JTopologyBuilder: Attaching components at top level = " << current_level << LOG_END;
 
     // We've now found our top level. No matter what, we need an event pool for this level
-    JEventPool* pool_at_level = new JEventPool(m_components,
-                                                m_event_pool_size,
-                                                m_location_count,
-                                                m_limit_total_events_in_flight, 
-                                                current_level);
-    pool_at_level->init();
+    JEventPool* pool_at_level = create_event_pool(current_level);
     pools.push_back(pool_at_level); // Hand over ownership of the pool to the topology
 
     // There are two possibilities at this point:
@@ -298,38 +394,40 @@ void JTopologyBuilder::attach_top_level(JEventLevel current_level) {
 
         LOG_DEBUG(GetLogger()) << "JTopologyBuilder: No unfolders found at level " << current_level << ", finishing here." << LOG_END;
 
-        auto queue = new EventQueue(m_event_queue_threshold, mapping.get_loc_count(), m_enable_stealing);
-        queues.push_back(queue);
+        auto q1 = create_event_queue();
+        auto q2 = create_event_queue();
+        queues.push_back(q1);
+        queues.push_back(q2);
 
-        auto* src_arrow = new JEventSourceArrow(level_str+"Source", sources_at_level, queue, pool_at_level);
+        auto* src_arrow = new JEventSourceArrow(level_str+"Source", sources_at_level, q1, pool_at_level, m_max_open_sources);
         arrows.push_back(src_arrow);
         src_arrow->set_chunksize(m_event_source_chunksize);
 
-        auto* proc_arrow = new JEventProcessorArrow(level_str+"Tap", queue, nullptr, pool_at_level);
-        arrows.push_back(proc_arrow);
-        proc_arrow->set_chunksize(m_event_processor_chunksize);
+        // Decoding happens here, in parallel, instead of in the source arrow
+        auto* map_arrow = new JEventMapArrow(level_str+"Map", q1, q2);
+        arrows.push_back(map_arrow);
+        map_arrow->set_chunksize(m_event_source_chunksize);
+        src_arrow->attach(map_arrow);
 
-        for (auto proc: procs_at_level) {
-            proc_arrow->add_processor(proc);
-        }
-        src_arrow->attach(proc_arrow);
+        auto proc_arrows = attach_processors(level_str, procs_at_level, q2, nullptr, pool_at_level, true, true);
+        map_arrow->attach(proc_arrows.first);
     }
     else if (unfolders_at_level.size() != 1) {
         throw JException("At most one unfolder must be provided for each level in the event hierarchy!");
     }
     else {
         
-        auto q1 = new EventQueue(m_event_queue_threshold, mapping.get_loc_count(), m_enable_stealing);
-        auto q2 = new EventQueue(m_event_queue_threshold, mapping.get_loc_count(), m_enable_stealing);
+        auto q1 = create_event_queue();
+        auto q2 = create_event_queue();
 
         queues.push_back(q1);
         queues.push_back(q2);
 
-        auto *src_arrow = new JEventSourceArrow(level_str+"Source", sources_at_level, q1, pool_at_level);
+        auto *src_arrow = new JEventSourceArrow(level_str+"Source", sources_at_level, q1, pool_at_level, m_max_open_sources);
         arrows.push_back(src_arrow);
         src_arrow->set_chunksize(m_event_source_chunksize);
 
-        auto *map_arrow = new JEventMapArrow(level_str+"Map", q1, q2);;
+        auto *map_arrow = new JEventMapArrow(level_str+"Map", q1, q2);
         arrows.push_back(map_arrow);
         map_arrow->set_chunksize(m_event_source_chunksize);
         src_arrow->attach(map_arrow);
@@ -354,19 +452,13 @@ void JTopologyBuilder::attach_top_level(JEventLevel current_level) {
 
         if (procs_at_level.size() != 0) {
 
-            auto q3 = new EventQueue(m_event_queue_threshold, mapping.get_loc_count(), m_enable_stealing);
+            auto q3 = create_event_queue();
             queues.push_back(q3);
 
-            auto* proc_arrow = new JEventProcessorArrow(level_str+"Tap", q3, nullptr, pool_at_level);
-            arrows.push_back(proc_arrow);
-            proc_arrow->set_chunksize(m_event_processor_chunksize);
-
-            for (auto proc: procs_at_level) {
-                proc_arrow->add_processor(proc);
-            }
+            auto proc_arrows = attach_processors(level_str, procs_at_level, q3, nullptr, pool_at_level, true, true);
 
             fold_arrow->attach_parent_out(q3);
-            fold_arrow->attach(proc_arrow);
+            fold_arrow->attach(proc_arrows.first);
         }
     }
 
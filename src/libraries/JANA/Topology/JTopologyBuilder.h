@@ -24,6 +24,8 @@ class JQueue;
 class JFoldArrow;
 class JUnfoldArrow;
 class JEventPool;
+class JEvent;
+template <typename T> class JMailbox;
 
 class JTopologyBuilder : public JService {
 public:
@@ -42,9 +44,15 @@ public:
     size_t m_event_queue_threshold = 80;
     size_t m_event_source_chunksize = 40;
     size_t m_event_processor_chunksize = 1;
+    size_t m_max_open_sources = 1;
     size_t m_location_count = 1;
     bool m_enable_stealing = false;
     bool m_limit_total_events_in_flight = true;
+    bool m_event_pool_first_touch = true;
+    bool m_event_pool_elastic = false;
+    size_t m_event_pool_trim_ms = 5000;
+    size_t m_max_bytes_in_flight = 0;
+    std::string m_queue_impl = "deque";
     int m_affinity = 0;
     int m_locality = 0;
 
@@ -77,8 +85,25 @@ public:
 
     void attach_top_level(JEventLevel current_level);
 
+    /// Wires up a parallel JEventProcessorArrow that prefetches the processors' inputs, followed by a chain of
+    /// sequential JEventReduceArrows, one per processor. The chain reads from `input_queue`, and its last arrow
+    /// writes to `output_queue`, or returns events to `pool` if `output_queue` is null. If `allow_ordering` is set,
+    /// each processor that asked for ordered events gets a JEventReorderArrow in front of it. Returns the first and last arrows.
+    std::pair<JArrow*, JArrow*> attach_processors(const std::string& level_str,
+                                                  const std::vector<JEventProcessor*>& procs,
+                                                  JMailbox<std::shared_ptr<JEvent>*>* input_queue,
+                                                  JMailbox<std::shared_ptr<JEvent>*>* output_queue,
+                                                  JEventPool* pool,
+                                                  bool is_sink,
+                                                  bool allow_ordering);
+
     std::string print_topology();
 
+    /// create_event_queue constructs an event queue using whichever JMailbox implementation
+    /// was selected via jana:queue_impl. The caller is responsible for adding it to `queues`.
+    JMailbox<std::shared_ptr<JEvent>*>* create_event_queue();
+
+    JEventPool* create_event_pool(JEventLevel level);
 
 };
 
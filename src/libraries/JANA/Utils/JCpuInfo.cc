@@ -17,6 +17,11 @@
 #endif // __aarch64__
 #else //__APPLE__ (i.e. Linux)
 #include <sched.h>
+#include <sys/syscall.h>
+#if __has_include(<linux/membarrier.h>) && defined(__NR_membarrier)
+#include <linux/membarrier.h>
+#define JANA2_HAVE_MEMBARRIER 1
+#endif
 #endif //__APPLE__
 
 
@@ -101,5 +106,20 @@ bool PinThreadToCpu(std::thread* thread, size_t cpu_id) {
     return true;
 }
 
-} // JCpuInfo namespace
+bool HasHeavyBarrier() {
+#ifdef JANA2_HAVE_MEMBARRIER
+    // Registration is required before MEMBARRIER_CMD_PRIVATE_EXPEDITED may be used, and fails on kernels before 4.14
+    static const bool is_registered = (syscall(__NR_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0, 0) == 0);
+    return is_registered;
+#else
+    return false;
+#endif
+}
 
+void HeavyBarrier() {
+#ifdef JANA2_HAVE_MEMBARRIER
+    syscall(__NR_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0, 0);
+#endif
+}
+
+} // JCpuInfo namespace
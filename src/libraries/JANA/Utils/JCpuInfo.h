@@ -24,4 +24,12 @@ namespace JCpuInfo {
 
     bool PinThreadToCpu(std::thread *thread, size_t cpu_id);
 
+    /// Whether HeavyBarrier() is available. On Linux this registers the process for membarrier(2) the first time.
+    bool HasHeavyBarrier();
+
+    /// Makes every other running thread of this process execute a full memory barrier, so that a thread on a hot
+    /// path can get away with a compiler-only barrier (std::atomic_signal_fence) where it would otherwise need a
+    /// full fence. Only call this if HasHeavyBarrier() returned true.
+    void HeavyBarrier();
+
 }
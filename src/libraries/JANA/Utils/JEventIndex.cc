@@ -0,0 +1,67 @@
+// Copyright 2024, Jefferson Science Associates, LLC.
+// Subject to the terms in the LICENSE file found in the top-level directory.
+
+#include <JANA/Utils/JEventIndex.h>
+#include <JANA/JException.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+
+static const char JEVENTINDEX_MAGIC[8] = {'J','A','N','A','I','D','X','2'};
+
+
+bool JEventIndex::Read(const std::string& sidecar_filename, const FileStamp& data_file_stamp) {
+
+    m_offsets.clear();
+    std::ifstream in(sidecar_filename, std::ios::binary);
+    if (!in) return false;
+
+    char magic[8];
+    FileStamp stamp;
+    uint64_t event_count = 0;
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char*>(&stamp.size), sizeof(stamp.size));
+    in.read(reinterpret_cast<char*>(&stamp.mtime_ns), sizeof(stamp.mtime_ns));
+    in.read(reinterpret_cast<char*>(&stamp.inode), sizeof(stamp.inode));
+    in.read(reinterpret_cast<char*>(&event_count), sizeof(event_count));
+    if (!in || std::memcmp(magic, JEVENTINDEX_MAGIC, sizeof(magic)) != 0) return false;
+    if (stamp.size != data_file_stamp.size || stamp.mtime_ns != data_file_stamp.mtime_ns ||
+        stamp.inode != data_file_stamp.inode) return false;  // Stale
+    if (event_count > stamp.size) return false;  // Corrupt: every event takes at least one byte
+
+    m_offsets.resize(event_count);
+    in.read(reinterpret_cast<char*>(m_offsets.data()), event_count * sizeof(uint64_t));
+    if (!in) {
+        m_offsets.clear();
+        return false;
+    }
+    return true;
+}
+
+
+void JEventIndex::Write(const std::string& sidecar_filename, const FileStamp& data_file_stamp) const {
+
+    // Write to a temporary file first, so that a concurrent reader never sees a partial index
+    std::string tmp_filename = sidecar_filename + ".tmp";
+    {
+        std::ofstream out(tmp_filename, std::ios::binary | std::ios::trunc);
+        uint64_t event_count = m_offsets.size();
+        out.write(JEVENTINDEX_MAGIC, sizeof(JEVENTINDEX_MAGIC));
+        out.write(reinterpret_cast<const char*>(&data_file_stamp.size), sizeof(data_file_stamp.size));
+        out.write(reinterpret_cast<const char*>(&data_file_stamp.mtime_ns), sizeof(data_file_stamp.mtime_ns));
+        out.write(reinterpret_cast<const char*>(&data_file_stamp.inode), sizeof(data_file_stamp.inode));
+        out.write(reinterpret_cast<const char*>(&event_count), sizeof(event_count));
+        out.write(reinterpret_cast<const char*>(m_offsets.data()), event_count * sizeof(uint64_t));
+        if (!out) {
+            std::remove(tmp_filename.c_str());
+            throw JException("Unable to write event index '%s'", tmp_filename.c_str());
+        }
+    }
+    if (std::rename(tmp_filename.c_str(), sidecar_filename.c_str()) != 0) {
+        std::remove(tmp_filename.c_str());
+        throw JException("Unable to write event index '%s'", sidecar_filename.c_str());
+    }
+}
+
@@ -0,0 +1,48 @@
+// Copyright 2024, Jefferson Science Associates, LLC.
+// Subject to the terms in the LICENSE file found in the top-level directory.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+/// JEventIndex maps the position of each event in a file (counting from 0) to its byte offset, so that a
+/// JEventSource can implement Seek() without reading everything in between. It lives in a sidecar file next to
+/// the data file, which is built during the first full pass and reused after that.
+///
+/// The sidecar format is, in native byte order:
+///     char[8]   magic "JANAIDX2"
+///     uint64_t  size of the data file in bytes
+///     int64_t   modification time of the data file, in nanoseconds since the epoch
+///     uint64_t  inode number of the data file
+///     uint64_t  event count N
+///     uint64_t  offsets[N]
+/// The size, modification time and inode let us notice when the data file has changed since the index was built,
+/// including when it was rewritten within the same second or replaced by a rename.
+class JEventIndex {
+    std::vector<uint64_t> m_offsets;
+
+public:
+    /// Identifies the version of the data file that the index was built from
+    struct FileStamp {
+        uint64_t size = 0;
+        int64_t mtime_ns = 0;
+        uint64_t inode = 0;
+    };
+
+    static std::string GetSidecarFilename(const std::string& data_filename) { return data_filename + ".jidx"; }
+
+    void Clear() { m_offsets.clear(); }
+    void Add(uint64_t offset) { m_offsets.push_back(offset); }
+    size_t GetEventCount() const { return m_offsets.size(); }
+    uint64_t GetOffset(size_t event_index) const { return m_offsets.at(event_index); }
+
+    /// Returns false, leaving the index empty, if the sidecar is missing, corrupt, or doesn't match the data file
+    bool Read(const std::string& sidecar_filename, const FileStamp& data_file_stamp);
+
+    /// Throws a JException if the sidecar can't be written
+    void Write(const std::string& sidecar_filename, const FileStamp& data_file_stamp) const;
+};
+
@@ -32,11 +32,16 @@ public:
         item->get()->SetLevel(m_level); // This needs to happen _after_ configure_event
     }
 
+    size_t measure_item(std::shared_ptr<JEvent>* item) override {
+        return sizeof(JEvent) + (*item)->GetFactorySet()->GetMemoryUsage();
+    }
+
     void release_item(std::shared_ptr<JEvent>* item) override {
         if (auto source = (*item)->GetJEventSource()) source->DoFinish(**item);
-        (*item)->mFactorySet->Release();
+        (*item)->ClearData();
         (*item)->mInspector.Reset();
         (*item)->GetJCallGraphRecorder()->Reset();
+        (*item)->SetEventIndex(-1);
         (*item)->Reset();
     }
 };
@@ -141,6 +141,34 @@ void JProcessorMapping::initialize(AffinityStrategy affinity, LocalityStrategy l
     m_initialized = true;
 }
 
+size_t JProcessorMapping::get_loc_cpu_id(size_t loc_id) const {
+    if (m_initialized) {
+        for (const Row& row : m_mapping) {
+            if (row.location_id == loc_id) return row.cpu_id;
+        }
+    }
+    return loc_id;
+}
+
+size_t JProcessorMapping::get_loc_distance(size_t loc_a, size_t loc_b) const {
+
+    if (loc_a == loc_b) return 0;
+    if (!m_initialized) return 1;
+
+    // Each location is represented by the first cpu we find which belongs to it
+    const Row* row_a = nullptr;
+    const Row* row_b = nullptr;
+    for (const Row& row : m_mapping) {
+        if (row_a == nullptr && row.location_id == loc_a) row_a = &row;
+        if (row_b == nullptr && row.location_id == loc_b) row_b = &row;
+    }
+    if (row_a == nullptr || row_b == nullptr) return 4;
+    if (row_a->core_id == row_b->core_id && row_a->socket_id == row_b->socket_id) return 1;
+    if (row_a->numa_domain_id == row_b->numa_domain_id) return 2;
+    if (row_a->socket_id == row_b->socket_id) return 3;
+    return 4;
+}
+
 std::ostream& operator<<(std::ostream& os, const JProcessorMapping::AffinityStrategy& s) {
     switch (s) {
         case JProcessorMapping::AffinityStrategy::ComputeBound: os << "compute-bound (favor fewer hyperthreads)"; break;
@@ -28,6 +28,14 @@ public:
         return (m_initialized) ? m_mapping[worker_id % m_mapping.size()].location_id : 0;
     }
 
+    inline bool is_initialized() const {
+        return m_initialized;
+    }
+
+    /// get_loc_cpu_id returns the first cpu which belongs to location loc_id. This is where we
+    /// pin a thread when we want memory to be first-touched inside that location's memory domain.
+    size_t get_loc_cpu_id(size_t loc_id) const;
+
     inline AffinityStrategy get_affinity() const {
         return m_affinity_strategy;
     }
@@ -36,6 +44,11 @@ public:
         return m_locality_strategy;
     }
 
+    /// get_loc_distance estimates how far apart two locations are in the memory hierarchy:
+    /// 0=same location, 1=same core, 2=same NUMA domain, 3=same socket, 4=different sockets.
+    /// If the mapping hasn't been built (e.g. locality=global), all distinct locations are at distance 1.
+    size_t get_loc_distance(size_t loc_a, size_t loc_b) const;
+
     friend std::ostream& operator<<(std::ostream& os, const JProcessorMapping& m);
     friend std::ostream& operator<<(std::ostream& os, const AffinityStrategy& s);
     friend std::ostream& operator<<(std::ostream& os, const LocalityStrategy& s);
@@ -0,0 +1,115 @@
+// Copyright 2024, Jefferson Science Associates, LLC.
+// Subject to the terms in the LICENSE file found in the top-level directory.
+
+#include <JANA/Utils/JReadAheadRing.h>
+#include <JANA/JException.h>
+
+#include <algorithm>
+
+
+JReadAheadRing::JReadAheadRing(size_t depth) {
+    if (depth == 0) {
+        throw JException("JReadAheadRing needs a depth of at least 1");
+    }
+    m_slots.resize(depth);
+}
+
+
+bool JReadAheadRing::push(Block& block) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_size == m_slots.size() && !m_is_stopped) {
+        auto start_time = clock_t::now();
+        m_cv.wait(lock, [&]{ return m_size < m_slots.size() || m_is_stopped; });
+        m_producer_stall_time += clock_t::now() - start_time;
+    }
+    if (m_is_stopped) return false;
+
+    std::swap(m_slots[(m_head + m_size) % m_slots.size()], block);
+    m_size += 1;
+    m_block_count += 1;
+    m_max_size = std::max(m_max_size, m_size);
+    return true;
+}
+
+
+void JReadAheadRing::finish(std::exception_ptr error) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_is_finished = true;
+    m_error = error;
+}
+
+
+bool JReadAheadRing::wait_for_stop(clock_t::duration timeout) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_cv.wait_for(lock, timeout, [&]{ return m_is_stopped; });
+}
+
+
+JReadAheadRing::PopResult JReadAheadRing::try_pop(Block& block) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_size == 0) {
+        if (m_is_finished) {
+            if (m_error != nullptr) {
+                auto error = m_error;
+                m_error = nullptr;  // Rethrow only once
+                std::rethrow_exception(error);
+            }
+            return PopResult::Finished;
+        }
+        if (!m_is_consumer_starved) {
+            m_is_consumer_starved = true;
+            m_consumer_starved_since = clock_t::now();
+        }
+        return PopResult::Empty;
+    }
+    if (m_is_consumer_starved) {
+        m_is_consumer_starved = false;
+        m_consumer_stall_time += clock_t::now() - m_consumer_starved_since;
+    }
+    bool was_full = (m_size == m_slots.size());
+    std::swap(m_slots[m_head], block);
+    m_head = (m_head + 1) % m_slots.size();
+    m_size -= 1;
+    if (was_full) {
+        m_cv.notify_all();
+    }
+    return PopResult::Success;
+}
+
+
+void JReadAheadRing::stop() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_is_stopped = true;
+    m_cv.notify_all();
+}
+
+
+size_t JReadAheadRing::get_size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_size;
+}
+
+
+size_t JReadAheadRing::get_max_size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_max_size;
+}
+
+
+size_t JReadAheadRing::get_block_count() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_block_count;
+}
+
+
+JReadAheadRing::clock_t::duration JReadAheadRing::get_producer_stall_time() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_producer_stall_time;
+}
+
+
+JReadAheadRing::clock_t::duration JReadAheadRing::get_consumer_stall_time() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_consumer_stall_time;
+}
+
@@ -0,0 +1,72 @@
+// Copyright 2024, Jefferson Science Associates, LLC.
+// Subject to the terms in the LICENSE file found in the top-level directory.
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <vector>
+
+
+/// JReadAheadRing is the bounded buffer between a JEventSource's read-ahead thread, which fills raw blocks via
+/// JEventSource::Read(), and whichever worker is currently running Emit(). Blocks are handed over by swapping
+/// vectors, so that their allocations get recycled instead of freed: the producer gets back whatever buffer the
+/// consumer returned last.
+///
+/// The producer blocks when the ring is full. The consumer never blocks, because Emit() runs on a worker thread that
+/// should go do something else instead. The time each side spent waiting on the other is recorded, so that users
+/// can tell whether the ring is too shallow, or whether I/O is the bottleneck.
+class JReadAheadRing {
+public:
+    using Block = std::vector<char>;
+    using clock_t = std::chrono::steady_clock;
+
+    enum class PopResult { Success, Empty, Finished };
+
+private:
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::vector<Block> m_slots;
+    size_t m_head = 0;       // Next slot to pop
+    size_t m_size = 0;       // Number of full slots
+    bool m_is_finished = false;  // No more blocks are coming from the producer
+    bool m_is_stopped = false;   // The consumer doesn't want any more blocks
+    std::exception_ptr m_error;
+
+    size_t m_max_size = 0;
+    size_t m_block_count = 0;
+    clock_t::duration m_producer_stall_time = clock_t::duration::zero();
+    clock_t::duration m_consumer_stall_time = clock_t::duration::zero();
+    bool m_is_consumer_starved = false;
+    clock_t::time_point m_consumer_starved_since;
+
+public:
+    explicit JReadAheadRing(size_t depth);
+
+    /// Producer side. Waits until there is space, then swaps `block` into the ring. Returns false, without taking
+    /// the block, if the consumer called stop() in the meantime.
+    bool push(Block& block);
+
+    /// Producer side. Marks the end of the stream. Any `error` gets rethrown to the consumer once it has
+    /// drained the blocks that came before it.
+    void finish(std::exception_ptr error=nullptr);
+
+    /// Producer side. Sleeps for up to `timeout`, returning early (with true) if the consumer called stop().
+    bool wait_for_stop(clock_t::duration timeout);
+
+    /// Consumer side. Swaps the oldest full block into `block` without waiting.
+    PopResult try_pop(Block& block);
+
+    /// Consumer side. Tells the producer to stop, and wakes it up if it is waiting for space.
+    void stop();
+
+    size_t get_depth() const { return m_slots.size(); }
+    size_t get_size() const;
+    size_t get_max_size() const;
+    size_t get_block_count() const;
+    clock_t::duration get_producer_stall_time() const;
+    clock_t::duration get_consumer_stall_time() const;
+};
+
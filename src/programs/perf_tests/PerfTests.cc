@@ -86,6 +86,41 @@ int main() {
         benchmarker.RunUntilFinished();
     }
 
+    for (bool first_touch : {false, true}) {
+
+        // Compare NUMA-local event pools whose events were constructed on the main thread (so all of their memory
+        // lands in the main thread's NUMA domain) against ones where each location constructs its own events.
+        // Remote memory traffic is best observed by running this under `perf stat -e node-loads,node-load-misses`
+        // (or `numastat -p`); the throughput difference shows up in the benchmark results on multi-socket machines.
+        // On a machine with a single NUMA domain, both runs should be indistinguishable.
+
+        auto params = new JParameterManager;
+        params->SetParameter("log:off", "JApplication,JPluginLoader,JArrowProcessingController,JArrow,JParameterManager");
+        params->SetParameter("jtest:write_csv", false);
+        params->SetParameter("jtest:parser_ms", 0);
+        params->SetParameter("jtest:disentangler_ms", 0);
+        params->SetParameter("jtest:tracker_ms", 0);
+        params->SetParameter("jtest:plotter_ms", 0);
+
+        // Make the events themselves big, so that touching them dominates
+        params->SetParameter("jtest:disentangler_bytes", 2000000);
+        params->SetParameter("jtest:tracker_bytes", 1000000);
+
+        params->SetParameter("jana:locality", 2);  // NUMA-domain-local queues and pools
+        params->SetParameter("jana:affinity", 1);  // Fill up NUMA domains one at a time
+        params->SetParameter("jana:event_pool_first_touch", first_touch);
+
+        params->SetParameter("benchmark:resultsdir", first_touch ? "perftest_numa_first_touch" : "perftest_numa_main_thread_init");
+
+        JApplication app(params);
+        auto logger = app.GetService<JLoggingService>()->get_logger("PerfTests");
+        app.AddPlugin("JTest");
+
+        LOG_INFO(logger) << "Running JTest with NUMA-local event pools, first touch = " << first_touch << LOG_END;
+        JBenchmarker benchmarker(&app);
+        benchmarker.RunUntilFinished();
+    }
+
 #if HAVE_PODIO
     {
         // Test that we can link against PODIO datamodel
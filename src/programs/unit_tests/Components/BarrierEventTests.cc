@@ -5,15 +5,65 @@
 #include "BarrierEventTests.h"
 #include "catch.hpp"
 
+#include <JANA/Topology/JEventSourceArrow.h>
+#include <JANA/Topology/JTopologyBuilder.h>
+
 TEST_CASE("BarrierEventTests") {
 	SECTION("Basic Barrier") {
+		global_resource = 0;
+		auto proc = new BarrierProcessor;
 		JApplication app;
-		app.Add(new BarrierProcessor);
+		app.Add(proc);
 		app.Add(new BarrierSource);
 		app.SetParameterValue("nthreads", 4);
         app.SetParameterValue("jana:event_source_chunksize", 1);
         app.SetParameterValue("jana:event_processor_chunksize", 1);
 		app.Run(true);
+
+		REQUIRE(global_resource == 9);
+		REQUIRE(proc->misordered_events.empty());
+		REQUIRE(proc->GetEventCount() == 99);
+
+		auto src_arrow = dynamic_cast<JEventSourceArrow*>(app.GetService<JTopologyBuilder>()->arrows.at(0));
+		REQUIRE(src_arrow != nullptr);
+		REQUIRE(src_arrow->get_barrier_count() == 9);
+	}
+
+	SECTION("Barriers with chunked sources and processors") {
+		global_resource = 0;
+		auto proc = new BarrierProcessor;
+		JApplication app;
+		app.Add(proc);
+		app.Add(new BarrierSource);
+		app.SetParameterValue("nthreads", 4);
+		app.SetParameterValue("log:global", "off");
+		app.Run(true);
+
+		REQUIRE(global_resource == 9);
+		REQUIRE(proc->misordered_events.empty());
+		REQUIRE(proc->GetEventCount() == 99);
+	}
+
+	SECTION("Barriers from concurrently open sources") {
+		global_resource = 0;
+		auto proc = new BarrierProcessor;
+		JApplication app;
+		app.Add(proc);
+		app.Add(new BarrierSource);
+		app.Add(new BarrierSource);
+		app.SetParameterValue("nthreads", 4);
+		app.SetParameterValue("jana:max_open_sources", 2);
+		app.SetParameterValue("jana:event_source_chunksize", 3);
+		app.SetParameterValue("log:global", "off");
+		app.Run(true);
+
+		// Each source has its own event numbers, so we can only check that every barrier got through
+		REQUIRE(global_resource == 18);
+		REQUIRE(proc->GetEventCount() == 198);
+
+		auto src_arrow = dynamic_cast<JEventSourceArrow*>(app.GetService<JTopologyBuilder>()->arrows.at(0));
+		REQUIRE(src_arrow != nullptr);
+		REQUIRE(src_arrow->get_barrier_count() == 18);
 	}
 };
 
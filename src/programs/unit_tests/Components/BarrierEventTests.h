@@ -46,11 +46,18 @@ public:
 struct BarrierProcessor : public JEventProcessor {
 
 public:
+    // Event numbers whose Process() saw the wrong number of barriers before them. Catch assertions aren't threadsafe.
+    std::vector<uint64_t> misordered_events;
+
     BarrierProcessor() {
         SetCallbackStyle(CallbackStyle::ExpertMode);
     }
     void Process(const JEvent& event) override {
 
+        // Every event must see exactly the barriers that were emitted before it
+        if (global_resource != (int) (event.GetEventNumber() / 10) - (event.GetSequential() ? 1 : 0)) {
+            misordered_events.push_back(event.GetEventNumber());
+        }
         if (event.GetSequential()) {
             global_resource += 1;
             LOG << "Barrier event = " << event.GetEventNumber() << ", writing global var = " << global_resource << LOG_END;
@@ -3,6 +3,8 @@
 
 #include <JANA/JEventProcessor.h>
 #include <JANA/JEventSource.h>
+#include <JANA/Topology/JArrow.h>
+#include <JANA/Topology/JTopologyBuilder.h>
 
 struct MyEventProcessor : public JEventProcessor {
     int init_count = 0;
@@ -83,3 +85,37 @@ TEST_CASE("JEventProcessor_Exception") {
     REQUIRE(found_throw == true);
 
 }
+
+TEST_CASE("JEventProcessor_ReduceArrows") {
+    auto first = new MyEventProcessor;
+    auto second = new MyEventProcessor;
+    int destroy_count = 0;
+    first->destroy_count = &destroy_count;
+    second->destroy_count = &destroy_count;
+    first->SetTypeName("FirstProcessor");
+    second->SetTypeName("SecondProcessor");
+
+    JApplication app;
+    app.SetParameterValue("log:global", "off");
+    app.SetParameterValue("nthreads", 4);
+    app.SetParameterValue("jana:nevents", 20);
+    app.Add(new JEventSource);
+    app.Add(first);
+    app.Add(second);
+    app.Run();
+
+    // Each processor gets its own sequential arrow, which runs Process() and Finish()
+    std::vector<std::string> reduce_arrows;
+    for (JArrow* arrow : app.GetService<JTopologyBuilder>()->arrows) {
+        if (arrow->get_name().find("Reduce:") != std::string::npos) {
+            REQUIRE(!arrow->is_parallel());
+            reduce_arrows.push_back(arrow->get_name());
+        }
+    }
+    REQUIRE(reduce_arrows == std::vector<std::string>{"PhysicsEventReduce:FirstProcessor", "PhysicsEventReduce:SecondProcessor"});
+
+    REQUIRE(first->process_count == 20);
+    REQUIRE(second->process_count == 20);
+    REQUIRE(first->finish_count == 1);
+    REQUIRE(second->finish_count == 1);
+}
@@ -0,0 +1,178 @@
+
+#include "catch.hpp"
+
+#include <JANA/JApplication.h>
+#include <JANA/JEventSourceMmap.h>
+#include <JANA/JEventProcessor.h>
+
+#include <cstdio>
+#include <fstream>
+
+namespace jana::mmaptests {
+
+/// Each event is a 1-byte length followed by that many payload bytes
+struct LengthPrefixedSource : public JEventSourceMmap {
+    LengthPrefixedSource(std::string filename) {
+        SetResourceName(filename);
+        SetTypeName("LengthPrefixedSource");
+    }
+    size_t find_count = 0;
+
+    size_t FindEventSize(const char* data, size_t available) override {
+        find_count++;
+        size_t event_size = 1 + static_cast<unsigned char>(data[0]);
+        return (event_size <= available) ? event_size : 0;
+    }
+    void FillEvent(JEvent& event, const JMmapView& view) override {
+        event.SetRunNumber(static_cast<int32_t>(view.file_offset));
+    }
+};
+
+struct ViewProcessor : public JEventProcessor {
+    std::vector<std::string> payloads;
+    std::vector<int32_t> offsets;
+    std::vector<uint64_t> event_numbers;
+    std::weak_ptr<const JMmapFile> file;
+
+    ViewProcessor() {
+        SetCallbackStyle(CallbackStyle::LegacyMode);
+    }
+    void Process(const std::shared_ptr<const JEvent>& event) override {
+        auto views = event->Get<JMmapView>();
+        REQUIRE(views.size() == 1);
+        payloads.push_back(std::string(views[0]->data + 1, views[0]->size - 1));
+        offsets.push_back(event->GetRunNumber());
+        event_numbers.push_back(event->GetEventNumber());
+        file = views[0]->file;
+    }
+};
+
+} // namespace jana::mmaptests
+
+
+namespace jana::mmaptests {
+
+void WriteTestFile(const std::string& filename) {
+    std::ofstream out(filename, std::ios::binary);
+    for (std::string payload : {"abc", "", "de", "fghij"}) {
+        out.put(static_cast<char>(payload.size()));
+        out << payload;
+    }
+    out.put(7);  // Truncated event at the end, which gets ignored
+    out << "xy";
+}
+
+} // namespace jana::mmaptests
+
+
+TEST_CASE("JEventSourceMmap_FramesEvents") {
+    using namespace jana::mmaptests;
+
+    std::string filename = "JEventSourceMmapTests.dat";
+    WriteTestFile(filename);
+
+    auto source = new LengthPrefixedSource(filename);
+    source->EnableEventIndex(false);
+    auto proc = new ViewProcessor;
+
+    JApplication app;
+    app.SetParameterValue("log:global", "off");
+    app.SetParameterValue("nthreads", 2);
+    app.Add(source);
+    app.Add(proc);
+    app.Run();
+
+    std::vector<std::pair<int32_t, std::string>> results;
+    for (size_t i=0; i<proc->payloads.size(); ++i) {
+        results.push_back({proc->offsets[i], proc->payloads[i]});
+    }
+    std::sort(results.begin(), results.end());
+    REQUIRE(results == std::vector<std::pair<int32_t, std::string>>{{0, "abc"}, {4, ""}, {5, "de"}, {8, "fghij"}});
+
+    // The source closed, and every event got recycled, so nothing is holding the mapping any more
+    REQUIRE(source->GetFile() == nullptr);
+    REQUIRE(proc->file.expired());
+
+    std::remove(filename.c_str());
+}
+
+
+TEST_CASE("JEventSourceMmap_SeekWithIndex") {
+    using namespace jana::mmaptests;
+
+    std::string filename = "JEventSourceMmapIndexTests.dat";
+    std::string sidecar_filename = JEventIndex::GetSidecarFilename(filename);
+    WriteTestFile(filename);
+    std::remove(sidecar_filename.c_str());
+
+    SECTION("FirstPassWritesIndex") {
+        auto source = new LengthPrefixedSource(filename);
+        JApplication app;
+        app.SetParameterValue("log:global", "off");
+        app.Add(source);
+        app.Add(new ViewProcessor);
+        app.Run();
+
+        REQUIRE(!source->IsEventIndexLoaded());
+        JMmapFile file(filename);
+        JEventIndex index;
+        REQUIRE(index.Read(sidecar_filename, file.GetFileStamp()));
+        REQUIRE(index.GetEventCount() == 4);
+        REQUIRE(index.GetOffset(3) == 8);
+
+        // Any change to the stamp makes the index stale, down to the nanosecond
+        auto stamp = file.GetFileStamp();
+        stamp.size += 1;
+        REQUIRE(!index.Read(sidecar_filename, stamp));
+        stamp = file.GetFileStamp();
+        stamp.mtime_ns += 1;
+        REQUIRE(!index.Read(sidecar_filename, stamp));
+        stamp = file.GetFileStamp();
+        stamp.inode += 1;
+        REQUIRE(!index.Read(sidecar_filename, stamp));
+    }
+
+    SECTION("SeekWithoutIndex") {
+        auto source = new LengthPrefixedSource(filename);
+        auto proc = new ViewProcessor;
+        JApplication app;
+        app.SetParameterValue("log:global", "off");
+        app.SetParameterValue("jana:nskip", 2);
+        app.Add(source);
+        app.Add(proc);
+        app.Run();
+
+        std::sort(proc->event_numbers.begin(), proc->event_numbers.end());
+        REQUIRE(proc->event_numbers == std::vector<uint64_t>{2,3});
+        REQUIRE(source->find_count == 5);  // Scanned past 2 events, framed 2, then found the truncated one
+        REQUIRE(source->GetEventIndex().GetEventCount() == 4);  // Still built the index along the way
+    }
+
+    SECTION("SeekWithIndex") {
+        {
+            // First pass builds the index
+            JApplication app;
+            app.SetParameterValue("log:global", "off");
+            app.Add(new LengthPrefixedSource(filename));
+            app.Add(new ViewProcessor);
+            app.Run();
+        }
+        auto source = new LengthPrefixedSource(filename);
+        auto proc = new ViewProcessor;
+        JApplication app;
+        app.SetParameterValue("log:global", "off");
+        app.SetParameterValue("jana:nskip", 3);
+        app.SetParameterValue("jana:nevents", 1);
+        app.Add(source);
+        app.Add(proc);
+        app.Run();
+
+        REQUIRE(source->IsEventIndexLoaded());
+        REQUIRE(source->find_count == 1);  // Jumped straight to the event we wanted
+        REQUIRE(proc->payloads == std::vector<std::string>{"fghij"});
+        REQUIRE(proc->event_numbers == std::vector<uint64_t>{3});
+    }
+
+    std::remove(sidecar_filename.c_str());
+    std::remove(filename.c_str());
+}
@@ -2,6 +2,10 @@
 #include "catch.hpp"
 
 #include <JANA/JEventSource.h>
+#include <JANA/JEventProcessor.h>
+
+#include <algorithm>
+#include <thread>
 
 struct MyEventSource : public JEventSource {
     int open_count = 0;
@@ -71,3 +75,277 @@ TEST_CASE("JEventSource_ExpertMode_EmitCount") {
 }
 
 
+
+/// Records which position in the stream an event was filled from, so that we can tell whether data leaks between events
+struct MyStreamPosition : public JObject {
+    uint64_t position;
+    explicit MyStreamPosition(uint64_t position) : position(position) {}
+};
+
+struct MyBatchEventSource : public JEventSource {
+    size_t events_in_file = 10;
+    size_t emit_batch_count = 0;
+    std::vector<size_t> batch_sizes;
+
+    Result EmitBatch(JEvent** events, size_t count, size_t& emitted_count) override {
+        emit_batch_count++;
+        batch_sizes.push_back(count);
+        emitted_count = 0;
+        while (emitted_count < count) {
+            if (GetEventCount() + emitted_count >= events_in_file) {
+                return Result::FailureFinished;
+            }
+            events[emitted_count]->SetRunNumber(22);
+            events[emitted_count]->Insert(new MyStreamPosition(GetEventCount() + emitted_count));
+            emitted_count++;
+        }
+        return Result::Success;
+    }
+};
+
+struct MyBatchEventProcessor : public JEventProcessor {
+    std::vector<uint64_t> event_numbers;
+    std::vector<std::vector<uint64_t>> positions;  // Per event, in the same order as event_numbers
+
+    MyBatchEventProcessor() {
+        SetCallbackStyle(CallbackStyle::LegacyMode);
+    }
+    void Process(const std::shared_ptr<const JEvent>& event) override {
+        // Legacy-mode Process() is called under a lock
+        REQUIRE(event->GetRunNumber() == 22);
+        event_numbers.push_back(event->GetEventNumber());
+        std::vector<uint64_t> event_positions;
+        for (auto* pos : event->Get<MyStreamPosition>("", false)) {
+            event_positions.push_back(pos->position);
+        }
+        positions.push_back(event_positions);
+    }
+};
+
+TEST_CASE("JEventSource_ExpertMode_EmitBatch") {
+
+    auto sut = new MyBatchEventSource;
+    sut->SetCallbackStyle(MyBatchEventSource::CallbackStyle::ExpertMode);
+    auto proc = new MyBatchEventProcessor;
+
+    JApplication app;
+    app.SetParameterValue("log:global", "off");
+    app.SetParameterValue("jana:event_source_chunksize", 4);
+    app.SetParameterValue("jana:event_pool_size", 8);
+    app.Add(sut);
+    app.Add(proc);
+
+    SECTION("FillsWholeChunks") {
+        app.Run();
+        REQUIRE(sut->GetEventCount() == 10);
+        REQUIRE(sut->batch_sizes.size() == sut->emit_batch_count);
+        REQUIRE(sut->batch_sizes.at(0) == 4);  // One EmitBatch call per chunk, not per event
+        REQUIRE(sut->emit_batch_count <= 5);   // 4 + 4 + 2, plus whatever the pool was short of
+        std::sort(proc->event_numbers.begin(), proc->event_numbers.end());
+        REQUIRE(proc->event_numbers == std::vector<uint64_t>{0,1,2,3,4,5,6,7,8,9});
+    }
+
+    SECTION("LimitedByNEvents") {
+        app.SetParameterValue("jana:nevents", 6);
+        app.Run();
+        REQUIRE(sut->GetEventCount() == 6);
+        for (size_t batch_size : sut->batch_sizes) {
+            REQUIRE(batch_size <= 4);  // Never asks for more events than jana:nevents allows
+        }
+        REQUIRE(proc->event_numbers.size() == 6);
+    }
+
+    SECTION("LimitedByNSkip") {
+        app.SetParameterValue("jana:nskip", 3);
+        app.Run();
+        REQUIRE(sut->GetEventCount() == 10);
+        // Events dropped because of nskip get refilled, and must not pass their data on
+        REQUIRE(proc->positions.size() == proc->event_numbers.size());
+        for (size_t i=0; i<proc->positions.size(); ++i) {
+            REQUIRE(proc->positions[i] == std::vector<uint64_t>{proc->event_numbers[i]});
+        }
+        std::sort(proc->event_numbers.begin(), proc->event_numbers.end());
+        REQUIRE(proc->event_numbers == std::vector<uint64_t>{3,4,5,6,7,8,9});
+    }
+}
+
+struct MyReadAheadEventSource : public JEventSource {
+    size_t blocks_in_file = 4;
+    size_t events_per_block = 3;
+    size_t read_count = 0;
+    std::thread::id read_thread_id;
+    std::vector<std::thread::id> emit_thread_ids;
+
+    std::vector<char> current_block;
+    size_t current_offset = 0;
+
+    MyReadAheadEventSource() {
+        SetCallbackStyle(CallbackStyle::ExpertMode);
+        SetReadAheadDepth(2);
+    }
+
+    Result Read(std::vector<char>& block) override {
+        read_thread_id = std::this_thread::get_id();
+        if (read_count == blocks_in_file) return Result::FailureFinished;
+        for (size_t i=0; i<events_per_block; ++i) {
+            block.push_back(static_cast<char>(read_count * events_per_block + i));
+        }
+        read_count++;
+        return Result::Success;
+    }
+
+    Result Emit(JEvent& event) override {
+        emit_thread_ids.push_back(std::this_thread::get_id());
+        if (current_offset == current_block.size()) {
+            auto result = NextBlock(current_block);
+            if (result != Result::Success) return result;
+            current_offset = 0;
+        }
+        event.SetEventNumber(100 + current_block[current_offset++]);
+        event.SetRunNumber(22);
+        return Result::Success;
+    }
+};
+
+TEST_CASE("JEventSource_ReadAhead") {
+
+    auto sut = new MyReadAheadEventSource;
+    auto proc = new MyBatchEventProcessor;
+    sut->SetTypeName("MyReadAheadEventSource");
+
+    JApplication app;
+    app.SetParameterValue("log:global", "off");
+    app.Add(sut);
+    app.Add(proc);
+    app.Run();
+
+    REQUIRE(sut->read_count == 4);
+    REQUIRE(sut->GetReadAheadRing() != nullptr);
+    REQUIRE(sut->GetReadAheadRing()->get_block_count() == 4);
+    REQUIRE(sut->GetReadAheadRing()->get_max_size() <= 2);
+    // Read() runs on the source's own thread
+    REQUIRE(std::count(sut->emit_thread_ids.begin(), sut->emit_thread_ids.end(), sut->read_thread_id) == 0);
+
+    std::sort(proc->event_numbers.begin(), proc->event_numbers.end());
+    REQUIRE(proc->event_numbers.size() == 12);
+    REQUIRE(proc->event_numbers.front() == 100);
+    REQUIRE(proc->event_numbers.back() == 111);
+
+    auto components = app.GetComponentSummary().FindComponents("MyReadAheadEventSource");
+    REQUIRE(!components.empty());  // Looked up by both type name and prefix, which are the same here
+    auto details = components[0]->GetDetails();
+    REQUIRE(details.size() == 4);
+    REQUIRE(details[0].first == "read_ahead_depth");
+    REQUIRE(details[0].second == "2");
+}
+
+struct MyClosingReadAheadEventSource : public MyReadAheadEventSource {
+    bool* was_closed;
+    explicit MyClosingReadAheadEventSource(bool* was_closed) : was_closed(was_closed) {}
+    void Close() override { *was_closed = true; }
+};
+
+TEST_CASE("JEventSource_ReadAheadStoppedOnShutdown") {
+    // A source that was opened, but whose topology never got finalized, gets closed by JComponentManager before it
+    // is deleted, so that its read-ahead thread never outlives the derived class
+    bool was_closed = false;
+    {
+        auto sut = new MyClosingReadAheadEventSource(&was_closed);
+        JApplication app;
+        app.SetParameterValue("log:global", "off");
+        app.Add(sut);
+        app.Initialize();
+        sut->DoOpen();
+        REQUIRE(sut->GetReadAheadRing() != nullptr);
+        REQUIRE(sut->GetStatus() == JEventSource::Status::Opened);
+    }
+    REQUIRE(was_closed);
+}
+
+struct MySeekableEventSource : public MyEventSource {
+    std::vector<uint64_t> seeks;
+
+    bool Seek(uint64_t event_index) override {
+        seeks.push_back(event_index);
+        return true;
+    }
+};
+
+TEST_CASE("JEventSource_Seek") {
+
+    auto sut = new MySeekableEventSource;
+    sut->SetCallbackStyle(MyEventSource::CallbackStyle::ExpertMode);
+
+    JApplication app;
+    app.SetParameterValue("log:global", "off");
+    app.SetParameterValue("jana:nskip", 3);
+    app.Add(sut);
+
+    SECTION("SkipsWithoutEmitting") {
+        app.Run();
+        REQUIRE(sut->seeks == std::vector<uint64_t>{3});
+        REQUIRE(sut->emit_count == 3);        // Emit called 2 times successfully and fails on the 3rd
+        REQUIRE(sut->GetEventCount() == 5);
+        REQUIRE(sut->GetEmittedEventCount() == 2);
+    }
+}
+
+struct MyRawHit : public JObject {
+    int raw;
+    explicit MyRawHit(int raw) : raw(raw) {}
+};
+
+struct MyDecodedHit : public JObject {
+    int value;
+    explicit MyDecodedHit(int value) : value(value) {}
+};
+
+struct MyDecodingEventSource : public JEventSource {
+    std::atomic_int preprocess_count {0};
+    int emitted = 0;
+
+    MyDecodingEventSource() {
+        SetCallbackStyle(CallbackStyle::ExpertMode);
+    }
+    Result Emit(JEvent& event) override {
+        if (emitted == 20) return Result::FailureFinished;
+        event.Insert(new MyRawHit(emitted++));
+        event.SetRunNumber(22);
+        return Result::Success;
+    }
+    void Preprocess(const JEvent& event) override {
+        preprocess_count++;
+        auto raw = event.GetSingle<MyRawHit>();
+        event.Insert(new MyDecodedHit(raw->raw * 10));
+    }
+};
+
+struct MyDecodedHitProcessor : public JEventProcessor {
+    std::vector<int> values;
+
+    MyDecodedHitProcessor() {
+        SetCallbackStyle(CallbackStyle::LegacyMode);
+    }
+    void Process(const std::shared_ptr<const JEvent>& event) override {
+        values.push_back(event->GetSingle<MyDecodedHit>()->value);
+    }
+};
+
+TEST_CASE("JEventSource_PreprocessInFlatTopology") {
+
+    auto sut = new MyDecodingEventSource;
+    auto proc = new MyDecodedHitProcessor;
+
+    JApplication app;
+    app.SetParameterValue("log:global", "off");
+    app.SetParameterValue("nthreads", 4);
+    app.Add(sut);
+    app.Add(proc);
+    app.Run();
+
+    REQUIRE(sut->preprocess_count == 20);
+    std::sort(proc->values.begin(), proc->values.end());
+    REQUIRE(proc->values.size() == 20);
+    REQUIRE(proc->values.front() == 0);
+    REQUIRE(proc->values.back() == 190);
+}
@@ -5,7 +5,17 @@
 #include "catch.hpp"
 
 #include <JANA/JEventSource.h>
+#include <JANA/JEventProcessor.h>
+#include <JANA/Topology/JEventSourceArrow.h>
+#include <JANA/Topology/JTopologyBuilder.h>
 
+#include <cstring>
+
+
+struct NEventNSkipPosition : public JObject {
+    int position;
+    explicit NEventNSkipPosition(int position) : position(position) {}
+};
 
 struct NEventNSkipBoundedSource : public JEventSource {
 
@@ -19,10 +29,11 @@ struct NEventNSkipBoundedSource : public JEventSource {
         SetCallbackStyle(CallbackStyle::ExpertMode);
     }
 
-    Result Emit(JEvent&) override {
+    Result Emit(JEvent& event) override {
         if (event_count >= event_bound) {
             return Result::FailureFinished;
         }
+        event.Insert(new NEventNSkipPosition(event_count));
         event_count += 1;
         events_emitted.push_back(event_count);
         return Result::Success;
@@ -81,6 +92,126 @@ TEST_CASE("NEventNSkipTests") {
     }
 }
 
+struct NEventNSkipSeekableSource : public NEventNSkipBoundedSource {
+    std::vector<uint64_t> seeks;
+
+    bool Seek(uint64_t event_index) override {
+        seeks.push_back(event_index);
+        event_count = event_index;
+        return true;
+    }
+};
+
+struct NEventNSkipEventNumberProcessor : public JEventProcessor {
+    std::vector<uint64_t> event_numbers;
+    size_t mismatched_events = 0;  // Events whose data doesn't match their own position in the stream
+
+    NEventNSkipEventNumberProcessor() {
+        SetCallbackStyle(CallbackStyle::LegacyMode);
+    }
+    void Process(const std::shared_ptr<const JEvent>& event) override {
+        event_numbers.push_back(event->GetEventNumber());
+        auto positions = event->Get<NEventNSkipPosition>();
+        if (positions.size() != 1 || positions[0]->position != (int) event->GetEventNumber()) {
+            mismatched_events++;
+        }
+    }
+};
+
+
+/// Reads one position per block on its own thread. Seeking moves where Read() continues from.
+struct NEventNSkipReadAheadSource : public JEventSource {
+    int event_bound = 100;
+    int next_read = 0;
+    std::vector<uint64_t> seeks;
+    std::vector<char> block;
+
+    NEventNSkipReadAheadSource() {
+        SetCallbackStyle(CallbackStyle::ExpertMode);
+        SetReadAheadDepth(4);
+    }
+    bool Seek(uint64_t event_index) override {
+        seeks.push_back(event_index);
+        next_read = event_index;
+        return true;
+    }
+    Result Read(std::vector<char>& block) override {
+        if (next_read >= event_bound) return Result::FailureFinished;
+        block.resize(sizeof(int));
+        std::memcpy(block.data(), &next_read, sizeof(int));
+        next_read++;
+        return Result::Success;
+    }
+    Result Emit(JEvent& event) override {
+        auto result = NextBlock(block);
+        if (result != Result::Success) return result;
+        int position;
+        std::memcpy(&position, block.data(), sizeof(int));
+        event.Insert(new NEventNSkipPosition(position));
+        return Result::Success;
+    }
+};
+
+
+TEST_CASE("NEventNSkipTests_Sharding") {
+
+    // Shard 1 of 3 with blocks of 10 gets positions [10,20), [40,50), [70,80) after nskip
+    std::vector<uint64_t> expected;
+    for (uint64_t block_start : {15, 45, 75}) {
+        for (uint64_t i=0; i<10; ++i) expected.push_back(block_start + i);
+    }
+
+    JApplication app;
+    app.SetParameterValue("log:global", "off");
+    app.SetParameterValue("jana:nskip", 5);
+    app.SetParameterValue("jana:shard_index", 1);
+    app.SetParameterValue("jana:shard_count", 3);
+    app.SetParameterValue("jana:shard_block_size", 10);
+    auto proc = new NEventNSkipEventNumberProcessor;
+    app.Add(proc);
+
+    SECTION("Without Seek(), events from other shards are read and discarded") {
+        auto source = new NEventNSkipBoundedSource;
+        app.Add(source);
+        app.Run(true);
+        REQUIRE(source->event_count == 100);
+        REQUIRE(proc->mismatched_events == 0);  // The discarded events' data doesn't leak into the kept ones
+        std::sort(proc->event_numbers.begin(), proc->event_numbers.end());
+        REQUIRE(proc->event_numbers == expected);
+    }
+
+    SECTION("With Seek(), the source jumps from one of its blocks to the next") {
+        auto source = new NEventNSkipSeekableSource;
+        app.Add(source);
+        app.Run(true);
+        REQUIRE(source->seeks == std::vector<uint64_t>{5, 15, 45, 75, 105});
+        REQUIRE(source->events_emitted.size() == 30);
+        REQUIRE(proc->mismatched_events == 0);
+        std::sort(proc->event_numbers.begin(), proc->event_numbers.end());
+        REQUIRE(proc->event_numbers == expected);
+    }
+
+    SECTION("With read-ahead, only the nskip seek happens, before the read-ahead thread starts") {
+        auto source = new NEventNSkipReadAheadSource;
+        app.Add(source);
+        app.Run(true);
+        REQUIRE(source->seeks == std::vector<uint64_t>{5});
+        REQUIRE(proc->mismatched_events == 0);
+        std::sort(proc->event_numbers.begin(), proc->event_numbers.end());
+        REQUIRE(proc->event_numbers == expected);
+    }
+
+    SECTION("jana:nevents limits the events emitted from this shard") {
+        auto source = new NEventNSkipSeekableSource;
+        app.SetParameterValue("jana:nevents", 12);
+        app.Add(source);
+        app.Run(true);
+        std::sort(proc->event_numbers.begin(), proc->event_numbers.end());
+        expected.resize(12);
+        REQUIRE(proc->event_numbers == expected);
+    }
+}
+
 TEST_CASE("JEventSourceArrow with multiple JEventSources") {
     JApplication app;
     app.SetParameterValue("log:info","JArrow,JArrowProcessingController");
@@ -171,5 +302,36 @@ TEST_CASE("JEventSourceArrow with multiple JEventSources") {
         REQUIRE(app.GetNEventsProcessed() == 21);
     }
 
+    SECTION("Several event sources are read concurrently, each keeping its own event numbering") {
+        source1->event_bound = 90;
+        source2->event_bound = 130;
+        source3->event_bound = 70;
+        source2->SetNSkip(10);
+
+        app.SetParameterValue("jana:max_open_sources", 2);
+        app.SetParameterValue("jana:event_source_chunksize", 5);
+        app.SetParameterValue("nthreads", 4);
+        app.Run(true);
+
+        auto src_arrow = dynamic_cast<JEventSourceArrow*>(app.GetService<JTopologyBuilder>()->arrows.at(0));
+        REQUIRE(src_arrow != nullptr);
+        REQUIRE(src_arrow->is_parallel());
+        REQUIRE(src_arrow->get_max_open_sources() == 2);
+
+        REQUIRE(app.GetExitCode() == (int) JApplication::ExitCode::Success);
+        for (auto* source : {source1, source2, source3}) {
+            REQUIRE(source->GetStatus() == JEventSource::Status::Closed);
+            REQUIRE(source->open_count == 1);
+            REQUIRE(source->close_count == 1);
+            REQUIRE(source->GetEventCount() == (uint64_t) source->event_bound);
+            REQUIRE(source->GetFinishedEventCount() == source->GetEmittedEventCount());
+            for (size_t i=0; i<source->events_emitted.size(); ++i) {
+                REQUIRE(source->events_emitted[i] == (int) i+1);
+            }
+        }
+        REQUIRE(source2->GetEmittedEventCount() == 120);
+        REQUIRE(app.GetNEventsProcessed() == 90+120+70);
+    }
+
 }
 
@@ -0,0 +1,50 @@
+// Copyright 2024, Jefferson Science Associates, LLC.
+// Subject to the terms in the LICENSE file found in the top-level directory.
+
+#include "catch.hpp"
+
+#include <JANA/Engine/JAutoscaler.h>
+
+TEST_CASE("AutoscalerHillClimbing") {
+
+    JAutoscaler autoscaler;
+    autoscaler.GetLogger().level = JLogger::Level::WARN;
+    autoscaler.set_bounds(1, 8);
+
+    // With nothing to compare against yet, we probe upwards
+    REQUIRE(autoscaler.decide(4, 100.0, 0.1) == 5);
+
+    // Keep climbing while throughput improves
+    REQUIRE(autoscaler.decide(5, 120.0, 0.1) == 6);
+
+    // No significant change means the extra thread wasn't worth it
+    REQUIRE(autoscaler.decide(6, 121.0, 0.1) == 5);
+
+    // Stepping down cost us throughput, so we turn around
+    REQUIRE(autoscaler.decide(5, 110.0, 0.1) == 6);
+
+    // Mostly-idle workers mean we have too many, whatever the throughput says
+    REQUIRE(autoscaler.decide(6, 200.0, 0.9) == 5);
+
+    auto& decisions = autoscaler.get_decisions();
+    REQUIRE(decisions.size() == 5);
+    REQUIRE(decisions[4].old_nthreads == 6);
+    REQUIRE(decisions[4].new_nthreads == 5);
+    REQUIRE(decisions[4].reason == "workers were mostly idle");
+}
+
+TEST_CASE("AutoscalerBounds") {
+
+    JAutoscaler autoscaler;
+    autoscaler.GetLogger().level = JLogger::Level::WARN;
+    autoscaler.set_bounds(2, 3);
+
+    REQUIRE(autoscaler.decide(3, 100.0, 0.0) == 2);   // Probing bounces off the upper bound
+    REQUIRE(autoscaler.decide(2, 100.0, 0.9) == 2);   // Idle at the lower bound stays put instead of bouncing up
+    REQUIRE(autoscaler.decide(2, 100.0, 0.9) == 2);
+    REQUIRE(autoscaler.get_decisions()[1].reason == "workers were mostly idle, but already at jana:autoscale_min");
+    REQUIRE(autoscaler.decide(8, 100.0, 0.0) == 3);   // Out-of-bounds thread counts get pulled back in
+
+    REQUIRE_THROWS_AS(autoscaler.set_bounds(4, 2), JException);
+    REQUIRE_THROWS_AS(autoscaler.set_bounds(0, 2), JException);
+}
@@ -62,6 +62,42 @@ TEST_CASE("ScaleNWorkerUpdate") {
     REQUIRE(threads == 8);
 }
 
+TEST_CASE("ScaleWithoutPausing") {
+    JApplication app;
+    app.SetParameterValue("nthreads",4);
+    app.SetParameterValue("log:global", "OFF");
+    app.SetParameterValue("log:warn", "JScheduler,JArrow,JWorker,JArrowProcessingController");
+    app.Add(new scaletest::DummySource);
+    app.Add(new scaletest::DummyProcessor);
+    app.Run(false);
+
+    auto pc = app.GetService<JArrowProcessingController>();
+    auto scheduler = pc->get_scheduler();
+
+    // Retired workers are removed entirely, and the topology never leaves Running
+    app.Scale(2);
+    REQUIRE(scheduler->get_topology_status() == JScheduler::TopologyStatus::Running);
+    auto perf_summary = pc->measure_performance();
+    REQUIRE(perf_summary->thread_count == 2);
+    REQUIRE(perf_summary->workers.size() == 2);
+
+    app.Scale(6);
+    REQUIRE(scheduler->get_topology_status() == JScheduler::TopologyStatus::Running);
+    perf_summary = pc->measure_performance();
+    REQUIRE(perf_summary->thread_count == 6);
+    REQUIRE(perf_summary->workers.size() == 6);
+
+    // Events keep flowing after rescaling
+    // Workers publish their metrics when they check in, so give them a few checkin intervals
+    auto events_before = perf_summary->monotonic_events_completed;
+    auto events_after = events_before;
+    for (int i=0; i<50 && events_after == events_before; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        events_after = pc->measure_performance()->monotonic_events_completed;
+    }
+    REQUIRE(events_after > events_before);
+}
+
 TEST_CASE("ScaleThroughputImprovement", "[.][performance]") {
 
     JApplication app;
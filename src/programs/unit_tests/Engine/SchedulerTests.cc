@@ -9,6 +9,7 @@
 #include <JANA/Topology/JTopologyBuilder.h>
 
 #include "../Topology/TestTopologyComponents.h"
+#include <thread>
 
 TEST_CASE("SchedulerTests") {
 
@@ -94,6 +95,41 @@ TEST_CASE("SchedulerTests") {
         assignment = scheduler.next_assignment(0, assignment, last_result);
         REQUIRE(assignment == nullptr);
     }
+
+    SECTION("When run concurrently, every arrow gets finalized and no events are lost") {
+
+        emit_rand_ints->emit_limit = 2000;
+        // MapArrow pushes into q2 without reserving space first, so q2 has to be able to hold every event at once
+        q2->set_threshold(emit_rand_ints->emit_limit);
+        std::atomic<size_t> finished_worker_count {0};
+        std::vector<std::thread> workers;
+
+        for (uint32_t worker_id=0; worker_id<4; ++worker_id) {
+            workers.emplace_back([&, worker_id]() {
+                JArrow* assignment = nullptr;
+                auto last_result = JArrowMetrics::Status::ComeBackLater;
+                while (scheduler.get_topology_status() == JScheduler::TopologyStatus::Running) {
+                    assignment = scheduler.next_assignment(worker_id, assignment, last_result);
+                    if (assignment != nullptr) {
+                        JArrowMetrics metrics;
+                        assignment->execute(metrics, 0);
+                        last_result = metrics.get_last_status();
+                    }
+                }
+                scheduler.last_assignment(worker_id, assignment, last_result);
+                finished_worker_count++;
+            });
+        }
+        for (auto& worker : workers) worker.join();
+
+        REQUIRE(finished_worker_count == 4);
+        JScheduler::TopologyState state = scheduler.get_topology_state();
+        for (auto& as : state.arrow_states) {
+            REQUIRE(as.status == JScheduler::ArrowStatus::Finalized);
+            REQUIRE(as.thread_count == 0);
+        }
+        REQUIRE(sum_everything->sum == 2.0 * emit_rand_ints->emit_sum - 2000);
+    }
 }
 
 TEST_CASE("SchedulerRoundRobinBehaviorTests") {
@@ -227,3 +263,271 @@ TEST_CASE("SchedulerRoundRobinBehaviorTests") {
 }
 
 
+
+TEST_CASE("SchedulerBackpressurePolicyTests") {
+
+    auto q1 = new JMailbox<int*>(4);
+    auto q2 = new JMailbox<double*>();
+    auto q3 = new JMailbox<double*>();
+
+    auto p1 = new JPool<int>(0,1,false);
+    auto p2 = new JPool<double>(0,1,false);
+    p1->init();
+    p2->init();
+
+    MultByTwoProcessor processor;
+
+    auto emit_rand_ints = new RandIntSource("emit_rand_ints", p1, q1);
+    auto multiply_by_two = new MapArrow<int*,double*>("multiply_by_two", processor, q1, q2);
+    auto subtract_one = new SubOneProcessor("subtract_one", q2, q3);
+    auto sum_everything = new SumSink<double>("sum_everything", q3, p2);
+
+    emit_rand_ints->attach(multiply_by_two);
+    multiply_by_two->attach(subtract_one);
+    subtract_one->attach(sum_everything);
+
+    auto topology = std::make_shared<JTopologyBuilder>();
+    topology->arrows.push_back(emit_rand_ints);
+    topology->arrows.push_back(multiply_by_two);
+    topology->arrows.push_back(subtract_one);
+    topology->arrows.push_back(sum_everything);
+
+    emit_rand_ints->set_chunksize(1);
+
+    JScheduler scheduler(topology);
+    scheduler.set_policy(JSchedulingPolicy::create("backpressure", topology->arrows.size()));
+    scheduler.run_topology(1);
+
+    // Only the source can make progress at first
+    JArrow* assignment = scheduler.next_assignment(0, nullptr, JArrowMetrics::Status::ComeBackLater);
+    REQUIRE(assignment == emit_rand_ints);
+
+    // Fill up the source's output queue
+    JArrowMetrics::Status last_result = JArrowMetrics::Status::KeepGoing;
+    for (int i=0; i<4; ++i) {
+        JArrowMetrics metrics;
+        emit_rand_ints->execute(metrics, 0);
+        last_result = metrics.get_last_status();
+    }
+    REQUIRE(q1->size() == 4);
+
+    // The source has no headroom left, so the worker gets the stage that can drain it instead
+    assignment = scheduler.next_assignment(0, assignment, last_result);
+    REQUIRE(assignment == multiply_by_two);
+
+    // Arrows that keep coming back empty-handed lose priority against equally-full arrows
+    auto policy = static_cast<JBackpressurePolicy*>(scheduler.get_policy());
+    REQUIRE(policy->get_success_rate(subtract_one->get_index()) == 1.0);
+    for (int i=0; i<4; ++i) {
+        JArrowMetrics metrics;
+        metrics.clear();
+        subtract_one->execute(metrics, 0);  // Nothing to do yet
+        policy->on_checkin(subtract_one, metrics.get_last_status(), &metrics);
+    }
+    REQUIRE(policy->get_success_rate(subtract_one->get_index()) < 1.0);
+
+    REQUIRE_THROWS_AS(JSchedulingPolicy::create("fastest", 4), JException);
+}
+
+
+TEST_CASE("SchedulerParkingLotTests") {
+
+    JParkingLot parking_lot;
+    size_t spin_budget = JParkingLot::MIN_SPIN_COUNT;
+
+    SECTION("Nobody waiting means notify() is a no-op") {
+        auto epoch = parking_lot.get_epoch();
+        parking_lot.notify();
+        REQUIRE(parking_lot.get_epoch() == epoch);
+    }
+
+    SECTION("A waiter times out when nothing happens") {
+        parking_lot.begin_waiting();
+        auto epoch = parking_lot.get_epoch();
+        bool notified = parking_lot.wait(epoch, spin_budget, std::chrono::milliseconds(10));
+        parking_lot.end_waiting();
+        REQUIRE(notified == false);
+        REQUIRE(parking_lot.get_waiting_count() == 0);
+        REQUIRE(parking_lot.get_parked_count() == 0);
+    }
+
+    SECTION("A notify() that happened before wait() is not lost") {
+        parking_lot.begin_waiting();
+        auto epoch = parking_lot.get_epoch();
+        parking_lot.notify();
+        REQUIRE(parking_lot.wait(epoch, spin_budget, std::chrono::seconds(10)) == true);
+        parking_lot.end_waiting();
+    }
+
+    SECTION("A push onto a mailbox wakes a parked waiter") {
+        JMailbox<int*> mailbox;
+        mailbox.set_push_notifier([&]{ parking_lot.notify(); });
+
+        std::atomic<bool> notified {false};
+        parking_lot.begin_waiting();
+        auto epoch = parking_lot.get_epoch();
+        std::thread waiter([&]{
+            size_t waiter_spin_budget = JParkingLot::MIN_SPIN_COUNT;
+            notified = parking_lot.wait(epoch, waiter_spin_budget, std::chrono::seconds(10));
+        });
+
+        int x = 22;
+        std::vector<int*> items {&x};
+        mailbox.push(items, 0);
+        waiter.join();
+        parking_lot.end_waiting();
+        REQUIRE(notified == true);
+    }
+    SECTION("No notify() is lost when it races begin_waiting()") {
+        // The relaxed store stands in for a push. Whether notify() uses a fence or relies on begin_waiting()'s
+        // heavy barrier, the waiter has to either see the item or be woken up, never time out.
+        std::atomic<size_t> pushed {0};
+        size_t lost_count = 0;
+        for (size_t i=1; i<=500; ++i) {
+            std::thread notifier([&, i]{
+                pushed.store(i, std::memory_order_relaxed);
+                parking_lot.notify();
+            });
+            parking_lot.begin_waiting();
+            auto epoch = parking_lot.get_epoch();
+            while (pushed.load(std::memory_order_relaxed) != i) {
+                if (!parking_lot.wait(epoch, spin_budget, std::chrono::seconds(5))) {
+                    lost_count++;
+                    break;
+                }
+                epoch = parking_lot.get_epoch();
+            }
+            parking_lot.end_waiting();
+            notifier.join();
+        }
+        REQUIRE(lost_count == 0);
+    }
+
+    SECTION("A push onto an event mailbox wakes a parked waiter promptly") {
+        // JMailbox<std::shared_ptr<JEvent>*> specializes push_and_unreserve(), so it needs its own coverage
+        JMailbox<std::shared_ptr<JEvent>*> mailbox;
+        mailbox.set_push_notifier([&]{ parking_lot.notify(); });
+
+        std::atomic<bool> notified {false};
+        parking_lot.begin_waiting();
+        auto epoch = parking_lot.get_epoch();
+        auto start_time = std::chrono::steady_clock::now();
+        std::thread waiter([&]{
+            size_t waiter_spin_budget = JParkingLot::MIN_SPIN_COUNT;
+            notified = parking_lot.wait(epoch, waiter_spin_budget, std::chrono::seconds(10));
+        });
+        while (parking_lot.get_parked_count() == 0) std::this_thread::yield();
+
+        auto event = std::make_shared<JEvent>();
+        std::shared_ptr<JEvent>* item = &event;
+        REQUIRE(mailbox.reserve(1) == 1);
+        mailbox.push_and_unreserve(&item, 1, 1);
+        waiter.join();
+        parking_lot.end_waiting();
+        REQUIRE(notified == true);
+        REQUIRE(std::chrono::steady_clock::now() - start_time < std::chrono::seconds(5));
+    }
+}
+
+
+TEST_CASE("SchedulerStickyAssignmentTests") {
+
+    auto q1 = new JMailbox<int*>(4);
+    auto q2 = new JMailbox<double*>();
+    auto q3 = new JMailbox<double*>();
+
+    auto p1 = new JPool<int>(0,1,false);
+    auto p2 = new JPool<double>(0,1,false);
+    p1->init();
+    p2->init();
+
+    MultByTwoProcessor processor;
+
+    auto emit_rand_ints = new RandIntSource("emit_rand_ints", p1, q1);
+    auto multiply_by_two = new MapArrow<int*,double*>("multiply_by_two", processor, q1, q2);
+    auto subtract_one = new SubOneProcessor("subtract_one", q2, q3);
+    auto sum_everything = new SumSink<double>("sum_everything", q3, p2);
+
+    emit_rand_ints->attach(multiply_by_two);
+    multiply_by_two->attach(subtract_one);
+    subtract_one->attach(sum_everything);
+
+    auto topology = std::make_shared<JTopologyBuilder>();
+    topology->arrows.push_back(emit_rand_ints);
+    topology->arrows.push_back(multiply_by_two);
+    topology->arrows.push_back(subtract_one);
+    topology->arrows.push_back(sum_everything);
+
+    emit_rand_ints->set_chunksize(1);
+
+    JScheduler scheduler(topology);
+    scheduler.set_sticky_assignments(true);
+    scheduler.run_topology(1);
+
+    JArrow* assignment = scheduler.next_assignment(0, nullptr, JArrowMetrics::Status::NotRunYet);
+    REQUIRE(assignment == emit_rand_ints);
+
+    // The source keeps its worker while it makes progress and has somewhere to put its output
+    JArrowMetrics::Status last_result = JArrowMetrics::Status::KeepGoing;
+    for (int i=0; i<3; ++i) {
+        JArrowMetrics metrics;
+        emit_rand_ints->execute(metrics, 0);
+        last_result = metrics.get_last_status();
+        REQUIRE(last_result == JArrowMetrics::Status::KeepGoing);
+        assignment = scheduler.next_assignment(0, assignment, last_result);
+        REQUIRE(assignment == emit_rand_ints);
+    }
+
+    // Once its output queue is full, the worker gets migrated
+    JArrowMetrics metrics;
+    emit_rand_ints->execute(metrics, 0);
+    REQUIRE(q1->size() == 4);
+    assignment = scheduler.next_assignment(0, assignment, metrics.get_last_status());
+    REQUIRE(assignment != emit_rand_ints);
+    REQUIRE(assignment != nullptr);
+}
+
+
+TEST_CASE("SchedulerCollectsPerWorkerMetrics") {
+
+    auto q1 = new JMailbox<int*>();
+    auto q2 = new JMailbox<double*>();
+    auto p1 = new JPool<int>(0,1,false);
+    auto p2 = new JPool<double>(0,1,false);
+    p1->init();
+    p2->init();
+
+    MultByTwoProcessor processor;
+    auto emit_rand_ints = new RandIntSource("emit_rand_ints", p1, q1);
+    auto multiply_by_two = new MapArrow<int*,double*>("multiply_by_two", processor, q1, q2);
+    auto sum_everything = new SumSink<double>("sum_everything", q2, p2);
+    emit_rand_ints->attach(multiply_by_two);
+    multiply_by_two->attach(sum_everything);
+
+    auto topology = std::make_shared<JTopologyBuilder>();
+    topology->arrows.push_back(emit_rand_ints);
+    topology->arrows.push_back(multiply_by_two);
+    topology->arrows.push_back(sum_everything);
+
+    JScheduler scheduler(topology);
+
+    // Each worker id gets its own block, and asking again returns the same one
+    JArrowMetrics* worker0 = scheduler.get_worker_arrow_metrics(0);
+    JArrowMetrics* worker3 = scheduler.get_worker_arrow_metrics(3);
+    REQUIRE(worker0 != worker3);
+    REQUIRE(scheduler.get_worker_arrow_metrics(0) == worker0);
+
+    auto idx = multiply_by_two->get_index();
+    worker0[idx].update(JArrowMetrics::Status::KeepGoing, 5, 2, std::chrono::milliseconds(5), std::chrono::milliseconds(1));
+    worker3[idx].update(JArrowMetrics::Status::KeepGoing, 7, 3, std::chrono::milliseconds(7), std::chrono::milliseconds(1));
+    multiply_by_two->get_metrics().update(JArrowMetrics::Status::ComeBackLater, 0, 1, std::chrono::milliseconds(0), std::chrono::milliseconds(1));
+
+    JArrowMetrics collected;
+    scheduler.collect_arrow_metrics(idx, collected);
+    REQUIRE(collected.get_total_message_count() == 12);
+    REQUIRE(collected.get_total_queue_visits() == 6);
+
+    // Other arrows are unaffected
+    scheduler.collect_arrow_metrics(sum_everything->get_index(), collected);
+    REQUIRE(collected.get_total_message_count() == 0);
+}
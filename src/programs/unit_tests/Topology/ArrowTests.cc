@@ -86,6 +86,33 @@ TEST_CASE("ArrowTests_Basic") {
 
 }
 
+TEST_CASE("ArrowTests_DataReusesOverflowBuffers") {
+
+    const size_t capacity = JANA2_ARROWDATA_MAX_SIZE * 4;
+    int** first_in_items;
+    int** first_out_items;
+    {
+        Data<int> in_data {0, capacity};
+        Data<int> out_data {0, capacity};
+        REQUIRE(in_data.items != out_data.items);
+        first_in_items = in_data.items;
+        first_out_items = out_data.items;
+    }
+    {
+        // The next execute() on this thread gets the same buffers back instead of allocating new ones
+        Data<int> in_data {0, capacity};
+        Data<int> out_data {0, capacity};
+        REQUIRE(in_data.items == first_in_items);
+        REQUIRE(out_data.items == first_out_items);
+        REQUIRE(in_data.items[capacity-1] == nullptr);
+    }
+    {
+        // Small chunks still live inline
+        Data<int> small_data {0, 2};
+        REQUIRE(small_data.items == small_data.inline_items.data());
+    }
+}
+
     
 } // namespace arrowtests
 } // namespace jana
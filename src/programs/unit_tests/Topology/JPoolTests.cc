@@ -1,6 +1,8 @@
 
 #include <catch.hpp>
 #include <JANA/Topology/JPool.h>
+#include <stdexcept>
+#include <thread>
 
 namespace jana {
 namespace jpooltests {
@@ -91,5 +93,266 @@ TEST_CASE("JPoolTests_SingleLocationUnlimitedEvents") {
 
 
 
+TEST_CASE("JPoolTests_OwningLocation") {
+
+    bool was_dtor_called = false;
+    JPool<Event> pool(2, 3, false);
+    pool.init();
+
+    Event* e = pool.get(1);
+    REQUIRE(pool.get_owning_location(e) == 1);
+
+    Event* f = pool.get(2);
+    REQUIRE(pool.get_owning_location(f) == 2);
+
+    Event* g = new Event;
+    g->was_dtor_called = &was_dtor_called;
+    REQUIRE(pool.get_owning_location(g) == 3);  // Heap-allocated
+
+    // Returning an item via the wrong location still sends it home
+    e->x = 11;
+    pool.put(e, 0);
+    Event* h = pool.get(1);
+    Event* i = pool.get(1);
+    REQUIRE((h->x == 11 || i->x == 11));
+
+    pool.put(g, 1);
+    REQUIRE(was_dtor_called == true);
+}
+
+struct TrackedEvent {
+    std::atomic<bool> in_use {false};
+};
+
+TEST_CASE("JPoolTests_MagazinesConcurrent") {
+
+    const size_t pool_size = 8;
+    JPool<TrackedEvent> pool(pool_size, 1, true);
+    pool.init();
+
+    std::atomic<size_t> double_use_count {0};
+    std::atomic<size_t> success_count {0};
+    std::vector<std::thread> threads;
+    for (size_t t=0; t<4; ++t) {
+        threads.emplace_back([&]() {
+            for (size_t iter=0; iter<10000; ++iter) {
+                TrackedEvent* items[3];
+                size_t count = pool.pop(items, 1, 3, 0);
+                for (size_t i=0; i<count; ++i) {
+                    if (items[i]->in_use.exchange(true)) double_use_count++;
+                }
+                for (size_t i=0; i<count; ++i) {
+                    items[i]->in_use = false;
+                }
+                pool.push(items, count, 0);
+                success_count += (count > 0);
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+
+    REQUIRE(double_use_count == 0);
+    REQUIRE(success_count > 0);
+
+    // At most half of the pool may be parked in magazines. The threads that parked them have exited, but get()
+    // drains their magazines once the shared free list runs dry, so every item is still reachable.
+    REQUIRE(pool.get_cached_count(0) <= pool_size / 2);
+    size_t reachable_count = 0;
+    while (pool.get(0) != nullptr) reachable_count++;
+    REQUIRE(reachable_count == pool_size);
+    REQUIRE(pool.get_cached_count(0) == 0);
+}
+
+TEST_CASE("JPoolTests_MagazinesOfRetiredThreads") {
+
+    JPool<Event> pool(4, 1, true);
+    pool.init();
+
+    // Make sure this thread has its own magazine, so that the worker below can't hand its slot over to us
+    pool.put(pool.get(0), 0);
+    REQUIRE(pool.get_cached_count(0) == 1);
+
+    std::thread worker([&]() {
+        Event* items[3];
+        REQUIRE(pool.pop(items, 3, 3, 0) == 3);
+        pool.push(items, 3, 0);
+    });
+    worker.join();
+    REQUIRE(pool.get_cached_count(0) == 2);  // One of them is parked in the retired worker's magazine
+
+    Event* items[4];
+    REQUIRE(pool.pop(items, 4, 4, 0) == 4);
+    REQUIRE(pool.get_cached_count(0) == 0);
+    for (size_t i=0; i<4; ++i) {
+        for (size_t j=0; j<i; ++j) {
+            REQUIRE(items[i] != items[j]);
+        }
+    }
+    pool.push(items, 4, 0);
+}
+
+TEST_CASE("JPoolTests_FirstTouchInit") {
+
+    JProcessorMapping mapping;
+    mapping.initialize(JProcessorMapping::AffinityStrategy::None, JProcessorMapping::LocalityStrategy::CpuLocal);
+    size_t loc_count = mapping.get_loc_count();
+
+    JPool<Event> pool(3, loc_count, true);
+    pool.init(mapping);
+
+    for (size_t loc=0; loc<loc_count; ++loc) {
+        Event* e = pool.get(loc);
+        REQUIRE(e != nullptr);
+        REQUIRE(e->x == 3);
+        REQUIRE(pool.get_owning_location(e) == loc);
+        pool.put(e, loc);
+    }
+}
+
+struct CountedEvent {
+    static std::atomic<int> live_count;
+    CountedEvent() { live_count++; }
+    ~CountedEvent() { live_count--; }
+};
+std::atomic<int> CountedEvent::live_count {0};
+
+struct FailingPool : public JPool<CountedEvent> {
+    size_t configured_count = 0;
+    size_t fail_at;
+    FailingPool(size_t pool_size, size_t location_count, size_t fail_at)
+        : JPool<CountedEvent>(pool_size, location_count, true), fail_at(fail_at) {}
+    void configure_item(CountedEvent*) override {
+        if (configured_count++ == fail_at) throw std::runtime_error("configure_item failed");
+    }
+};
+
+TEST_CASE("JPoolTests_ConfigureItemThrows") {
+
+    JProcessorMapping mapping;
+    mapping.initialize(JProcessorMapping::AffinityStrategy::None, JProcessorMapping::LocalityStrategy::CpuLocal);
+    size_t loc_count = mapping.get_loc_count();
+
+    SECTION("First-touch init rethrows on the calling thread") {
+        {
+            // Fails partway through the last location's slice
+            FailingPool pool(3, loc_count, 3*loc_count - 2);
+            REQUIRE_THROWS_AS(pool.init(mapping), std::runtime_error);
+        }
+        REQUIRE(CountedEvent::live_count == 0);
+    }
+    SECTION("Plain init") {
+        {
+            FailingPool pool(3, loc_count, 1);
+            REQUIRE_THROWS_AS(pool.init(), std::runtime_error);
+        }
+        REQUIRE(CountedEvent::live_count == 0);
+    }
+}
+
+TEST_CASE("JPoolTests_Elastic") {
+
+    bool was_dtor_called = false;
+    JPool<Event> pool(1, 1, false);
+    pool.set_elastic(true, std::chrono::milliseconds(50));
+    pool.init();
+
+    Event* e = pool.get(0);
+    Event* f = pool.get(0);   // Overflow
+    Event* g = pool.get(0);   // Overflow
+    REQUIRE(pool.get_overflow_count() == 2);
+    REQUIRE(pool.get_overflow_high_water() == 2);
+
+    f->x = 5;
+    f->was_dtor_called = &was_dtor_called;
+    pool.put(f, 0);
+    // f is kept around for reuse instead of being deleted
+    REQUIRE(was_dtor_called == false);
+    REQUIRE(pool.get_overflow_count() == 2);
+
+    Event* h = pool.get(0);
+    REQUIRE(h == f);
+    REQUIRE(pool.get_overflow_count() == 2);
+
+    // Once demand has been quiet for long enough, returned overflow items get trimmed
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    pool.put(h, 0);
+    REQUIRE(was_dtor_called == true);
+    pool.put(g, 0);
+    REQUIRE(pool.get_overflow_count() == 0);
+    REQUIRE(pool.get_overflow_high_water() == 2);
+
+    pool.put(e, 0);
+}
+
+TEST_CASE("JPoolTests_ElasticTrimsAfterAllReturned") {
+
+    bool was_dtor_called = false;
+    JPool<Event> pool(1, 1, false);
+    pool.set_elastic(true, std::chrono::milliseconds(50));
+    pool.init();
+
+    Event* e = pool.get(0);
+    Event* f = pool.get(0);   // Overflow
+    f->was_dtor_called = &was_dtor_called;
+
+    // Every overflow item comes back before the quiet period ends, so returning it can't trim anything
+    pool.put(f, 0);
+    REQUIRE(was_dtor_called == false);
+    REQUIRE(pool.get_overflow_count() == 1);
+
+    // Regular traffic that never needs an overflow item still trims once the quiet period is over
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    pool.put(e, 0);
+    REQUIRE(was_dtor_called == true);
+    REQUIRE(pool.get_overflow_count() == 0);
+
+    e = pool.get(0);
+    REQUIRE(pool.get_overflow_count() == 0);
+    pool.put(e, 0);
+}
+
+struct SizedEventPool : public JPool<Event> {
+    using JPool<Event>::JPool;
+    size_t measure_item(Event* item) override { return item->x; }
+};
+
+TEST_CASE("JPoolTests_ByteBudget") {
+
+    SizedEventPool parents(10, 1, true);
+    SizedEventPool children(10, 1, true);
+    parents.init();
+    children.init();
+    JPoolBase::share_byte_budget({&parents, &children}, 1000);
+
+    // Nothing has been measured yet, so the budget can't constrain anything
+    Event* items[10];
+    REQUIRE(parents.pop(items, 1, 2, 0) == 2);
+    items[0]->x = 300;
+    items[1]->x = 300;
+    parents.push(items, 2, 0);
+    REQUIRE(parents.get_bytes_per_item() == 300);
+    REQUIRE(parents.get_bytes_in_flight() == 0);
+
+    // 1000 bytes fit 3 events of 300 bytes
+    REQUIRE(parents.pop(items, 1, 10, 0) == 3);
+    REQUIRE(parents.get_bytes_in_flight() == 900);
+    REQUIRE(parents.pop(items+3, 1, 10, 0) == 0);
+    REQUIRE(parents.get(0) == nullptr);
+
+    // A pool with nothing in flight may always hand out one item, even if the shared budget is used up
+    Event* child = children.get(0);
+    REQUIRE(child != nullptr);
+    child->x = 50;
+    children.put(child, 0);
+
+    // Returning items frees up budget again
+    parents.push(items, 1, 0);
+    REQUIRE(parents.get_bytes_in_flight() == 600);
+    REQUIRE(parents.pop(items, 1, 10, 0) == 1);
+    parents.push(items, 3, 0);
+    REQUIRE(parents.get_bytes_in_flight() == 0);
+}
+
+
 } // namespace jana
 } // namespace jpooltests
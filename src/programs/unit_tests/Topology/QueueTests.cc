@@ -3,6 +3,8 @@
 // Subject to the terms in the LICENSE file found in the top-level directory.
 
 #include <JANA/Topology/JMailbox.h>
+#include <JANA/Topology/JRingMailbox.h>
+#include <thread>
 
 #include "catch.hpp"
 
@@ -37,3 +39,184 @@ TEST_CASE("QueueTests_Basic") {
     REQUIRE(count == 2);
     REQUIRE(q.size() == 1);
 }
+
+TEST_CASE("QueueTests_LockFreeCounters") {
+
+    JMailbox<int*> q {10, 2, false};
+    int a = 1, b = 2, c = 3;
+    int* items[3] = {&a, &b, &c};
+
+    size_t reserve_count = q.reserve(1, 3, 1);
+    REQUIRE(reserve_count == 3);
+    REQUIRE(q.get_reserved_count(1) == 3);
+    REQUIRE(q.get_reserved_count(0) == 0);
+
+    q.push_and_unreserve(items, 3, reserve_count, 1);
+    REQUIRE(q.get_reserved_count(1) == 0);
+    REQUIRE(q.size(0) == 0);
+    REQUIRE(q.size(1) == 3);
+    REQUIRE(q.size() == 3);
+
+    auto count = q.pop_and_reserve(items, 1, 2, 1);
+    REQUIRE(count == 2);
+    REQUIRE(q.size(1) == 1);
+    REQUIRE(q.get_reserved_count(1) == 2);
+
+    q.unreserve(2, 1);
+    REQUIRE(q.get_reserved_count(1) == 0);
+
+    bool success = false;
+    q.pop(items[0], success, 1);
+    REQUIRE(success);
+    REQUIRE(q.size() == 0);
+}
+
+TEST_CASE("QueueTests_RingBasic") {
+
+    JRingMailbox<int*> q {6, 1, false};
+    REQUIRE(q.get_slot_count() == 8);
+    REQUIRE(q.size() == 0);
+
+    int* item = new int {22};
+    bool result = q.try_push(&item, 1, 0);
+    REQUIRE(result == true);
+    REQUIRE(item == nullptr);
+    REQUIRE(q.size() == 1);
+
+    int* items[10];
+    auto count = q.pop(items, 2, 10, 0);
+    REQUIRE(count == 0);   // Can't satisfy min_requested_count
+    REQUIRE(q.size() == 1);
+
+    count = q.pop(items, 1, 10, 0);
+    REQUIRE(count == 1);
+    REQUIRE(q.size() == 0);
+    REQUIRE(*(items[0]) == 22);
+
+    items[1] = new int {44};
+    items[2] = new int {55};
+
+    size_t reserve_count = q.reserve(3, 5, 0);
+    REQUIRE(reserve_count == 5);
+    REQUIRE(q.reserve(2, 5, 0) == 0);  // Only 1 slot left below the threshold
+
+    q.push_and_unreserve(items, 3, reserve_count, 0);
+    REQUIRE(q.size() == 3);
+
+    count = q.pop_and_reserve(items, 2, 2, 0);
+    REQUIRE(count == 2);
+    REQUIRE(q.size() == 1);
+    REQUIRE(q.reserve(0, 10, 0) == 3); // 6 - 1 queued - 2 reserved for the popped items
+
+    q.unreserve(3, 0);
+    q.push_and_unreserve(items, 2, 2, 0);
+    REQUIRE(q.size() == 3);
+
+    count = q.pop(items, 1, 10, 0);
+    REQUIRE(count == 3);
+    for (size_t i=0; i<count; ++i) {
+        delete items[i];
+    }
+}
+
+TEST_CASE("QueueTests_RingPopsKeepOrderAndReserveExactly") {
+
+    JRingMailbox<int*> q {8, 1, false};
+    int values[4] = {0, 1, 2, 3};
+    int* items[8];
+    for (int i=0; i<4; ++i) items[i] = &values[i];
+    REQUIRE(q.try_push(items, 4, 0));
+
+    // A pop that can't reach its minimum takes nothing, so the order is unchanged
+    REQUIRE(q.pop(items, 5, 8, 0) == 0);
+    REQUIRE(q.pop_and_reserve(items, 5, 8, 0) == 0);
+    REQUIRE(q.size() == 4);
+    REQUIRE(q.reserve(0, 8, 0) == 4);  // No reservation is left behind by the failed attempts
+    q.unreserve(4, 0);
+
+    // A large chunk reserves only what it actually took
+    REQUIRE(q.pop_and_reserve(items, 1, 3, 0) == 3);
+    REQUIRE(q.reserve(0, 8, 0) == 4);  // 8 - 1 queued - 3 reserved
+    q.unreserve(4 + 3, 0);
+    for (int i=0; i<3; ++i) REQUIRE(*items[i] == i);
+
+    REQUIRE(q.pop(items, 1, 8, 0) == 1);
+    REQUIRE(*items[0] == 3);
+}
+
+TEST_CASE("QueueTests_RingConcurrent") {
+
+    const size_t item_count = 20000;
+    JRingMailbox<size_t*> q {16, 1, false};
+    std::vector<size_t> items(item_count);
+    std::atomic<size_t> popped_sum {0};
+    std::atomic<size_t> popped_count {0};
+
+    auto producer = [&](size_t start) {
+        for (size_t i=start; i<item_count; i+=2) {
+            items[i] = i;
+            size_t* ptr = &items[i];
+            while (q.reserve(1, 1, 0) == 0) {}
+            q.push_and_unreserve(&ptr, 1, 1, 0);
+        }
+    };
+    auto consumer = [&]() {
+        size_t* buffer[4];
+        while (popped_count < item_count) {
+            auto count = q.pop_and_reserve(buffer, 1, 4, 0);
+            for (size_t i=0; i<count; ++i) {
+                popped_sum += *buffer[i];
+            }
+            popped_count += count;
+            q.unreserve(count, 0);
+        }
+    };
+    std::thread p1(producer, 0), p2(producer, 1), c1(consumer), c2(consumer);
+    p1.join(); p2.join(); c1.join(); c2.join();
+
+    REQUIRE(popped_count == item_count);
+    REQUIRE(popped_sum == item_count * (item_count-1) / 2);
+    REQUIRE(q.size() == 0);
+}
+
+template <typename MailboxT>
+void test_work_stealing(bool enable_work_stealing) {
+
+    MailboxT q {8, 3, enable_work_stealing};
+    int data[6] = {0, 1, 2, 3, 4, 5};
+    int* items[6];
+    for (size_t i=0; i<6; ++i) items[i] = &data[i];
+
+    q.push_and_unreserve(items, 1, 0, 1);     // Location 1 has a backlog of 1
+    q.push_and_unreserve(items+1, 4, 0, 2);   // Location 2 has a backlog of 4
+
+    int* popped[4];
+    auto count = q.pop_and_reserve(popped, 1, 4, 0);
+    if (!enable_work_stealing) {
+        REQUIRE(count == 0);
+        REQUIRE(q.get_steal_count() == 0);
+        return;
+    }
+    // We take half of the most-loaded sibling's backlog
+    REQUIRE(count == 2);
+    REQUIRE(*popped[0] == 1);
+    REQUIRE(*popped[1] == 2);
+    REQUIRE(q.get_steal_count() == 2);
+    REQUIRE(q.size(0) == 0);
+    REQUIRE(q.size(1) == 1);
+    REQUIRE(q.size(2) == 2);
+
+    // The stolen items are reserved against the thief's location, so they can be pushed back there
+    REQUIRE(q.reserve(0, 8, 0) == 6);
+    q.unreserve(6, 0);
+    q.push_and_unreserve(popped, 2, 2, 0);
+    REQUIRE(q.size(0) == 2);
+    REQUIRE(q.reserve(0, 8, 0) == 6);
+}
+
+TEST_CASE("QueueTests_WorkStealing") {
+    SECTION("Deque, stealing enabled") { test_work_stealing<JMailbox<int*>>(true); }
+    SECTION("Deque, stealing disabled") { test_work_stealing<JMailbox<int*>>(false); }
+    SECTION("Ring, stealing enabled") { test_work_stealing<JRingMailbox<int*>>(true); }
+    SECTION("Ring, stealing disabled") { test_work_stealing<JRingMailbox<int*>>(false); }
+}
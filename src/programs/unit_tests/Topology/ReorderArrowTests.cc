@@ -0,0 +1,146 @@
+// Copyright 2024, Jefferson Science Associates, LLC.
+// Subject to the terms in the LICENSE file found in the top-level directory.
+
+#include <catch.hpp>
+
+#include <JANA/JApplication.h>
+#include <JANA/JEventProcessor.h>
+#include <JANA/JEventSource.h>
+#include <JANA/JFactoryGenerator.h>
+#include <JANA/JFactoryT.h>
+#include <JANA/Topology/JEventReorderArrow.h>
+#include <JANA/Topology/JTopologyBuilder.h>
+
+#include <thread>
+
+namespace jana {
+namespace reorderarrowtests {
+
+using EventT = std::shared_ptr<JEvent>;
+
+TEST_CASE("ReorderArrowTests_Basic") {
+
+    JMailbox<EventT*> input_queue {20};
+    JMailbox<EventT*> output_queue {20};
+
+    std::vector<EventT> events;
+    for (int i=0; i<5; ++i) {
+        events.push_back(std::make_shared<JEvent>());
+    }
+
+    SECTION("Events come out in index order") {
+        JEventReorderArrow arrow("reorder", &input_queue, &output_queue, 10);
+        arrow.set_chunksize(10);
+
+        std::vector<EventT*> scrambled;
+        for (int64_t index : {3, 1, 4, 2, 0}) {
+            events[index]->SetEventIndex(index);
+            scrambled.push_back(&events[index]);
+        }
+
+        // Events arrive in two batches. Nothing can be released until index 0 shows up.
+        input_queue.try_push(scrambled.data(), 3);
+        JArrowMetrics metrics;
+        arrow.execute(metrics, 0);
+        REQUIRE(output_queue.size() == 0);
+        REQUIRE(arrow.get_buffered_count() == 3);
+        REQUIRE(arrow.get_pending() == 3);
+
+        input_queue.try_push(scrambled.data()+3, 2);
+        arrow.execute(metrics, 0);
+        REQUIRE(output_queue.size() == 5);
+        REQUIRE(arrow.get_buffered_count() == 0);
+
+        EventT* results[5];
+        REQUIRE(output_queue.pop(results, 5, 5) == 5);
+        for (int64_t i=0; i<5; ++i) {
+            REQUIRE((*results[i])->GetEventIndex() == i);
+        }
+    }
+
+    SECTION("A full buffer only takes events that it can release") {
+        JEventReorderArrow arrow("reorder", &input_queue, &output_queue, 2);
+        arrow.set_chunksize(10);
+
+        std::vector<EventT*> scrambled;
+        for (int64_t index : {2, 3, 4, 1, 0}) {
+            events[index]->SetEventIndex(index);
+            scrambled.push_back(&events[index]);
+        }
+        input_queue.try_push(scrambled.data(), 5);
+
+        for (int i=0; i<20 && (input_queue.size() != 0 || arrow.get_buffered_count() != 0); ++i) {
+            JArrowMetrics metrics;
+            arrow.execute(metrics, 0);
+            REQUIRE(arrow.get_buffered_count() <= 2);
+        }
+        REQUIRE(input_queue.size() == 0);
+        REQUIRE(arrow.get_buffered_count() == 0);
+
+        EventT* results[5];
+        REQUIRE(output_queue.pop(results, 5, 5) == 5);
+        for (int64_t i=0; i<5; ++i) {
+            REQUIRE((*results[i])->GetEventIndex() == i);
+        }
+    }
+}
+
+
+struct SlowObject {
+    int value;
+};
+
+struct SlowObjectFactory : public JFactoryT<SlowObject> {
+    void Process(const std::shared_ptr<const JEvent>& event) override {
+        // Early events take longest, so that they finish out of order
+        auto index = event->GetEventIndex();
+        std::this_thread::sleep_for(std::chrono::milliseconds(index % 4 == 0 ? 20 : 1));
+        Insert(new SlowObject {(int) index});
+    }
+};
+
+struct OrderedProcessor : public JEventProcessor {
+    Input<SlowObject> m_objects {this, {.name=""}};
+    std::vector<int64_t> indices;
+    size_t missing_object_count = 0;
+
+    OrderedProcessor() {
+        SetTypeName("OrderedProcessor");
+        SetCallbackStyle(CallbackStyle::ExpertMode);
+        SetEventsOrdered(true);
+    }
+    void Process(const JEvent& event) override {
+        // Catch assertions aren't threadsafe, so we check these afterwards
+        if (m_objects().size() != 1) missing_object_count++;
+        indices.push_back(event.GetEventIndex());
+    }
+};
+
+TEST_CASE("ReorderArrowTests_EndToEnd") {
+    auto proc = new OrderedProcessor;
+
+    JApplication app;
+    app.SetParameterValue("log:global", "off");
+    app.SetParameterValue("nthreads", 4);
+    app.SetParameterValue("jana:nevents", 40);
+    app.SetParameterValue("jana:nskip", 3);
+    app.Add(new JEventSource);
+    app.Add(new JFactoryGeneratorT<SlowObjectFactory>);
+    app.Add(proc);
+    app.Run();
+
+    bool found_reorder_arrow = false;
+    for (JArrow* arrow : app.GetService<JTopologyBuilder>()->arrows) {
+        if (arrow->get_name() == "PhysicsEventReorder:OrderedProcessor") found_reorder_arrow = true;
+    }
+    REQUIRE(found_reorder_arrow);
+
+    REQUIRE(proc->missing_object_count == 0);
+    REQUIRE(proc->indices.size() == 40);
+    for (int64_t i=0; i<40; ++i) {
+        REQUIRE(proc->indices[i] == i);
+    }
+}
+
+} // namespace reorderarrowtests
+} // namespace jana
@@ -260,3 +260,50 @@ TEST_CASE("JTopology: Basic functionality") {
 
     }
 }
+
+TEST_CASE("JTopology: Chunked pipeline arrows") {
+
+    // A pool that doesn't limit events in flight only allocates min_count items per pop, so use a bounded one
+    auto q1 = new JMailbox<int*>(100);
+    auto p1 = new JPool<int>(32,1,true);
+    p1->init();
+
+    RandIntSource emit_rand_ints("emit_rand_ints", p1, q1);
+    SumSink<int> sum_everything("sum_everything", q1, p1);
+
+    SECTION("Each execute() moves up to chunksize events") {
+        emit_rand_ints.set_chunksize(5);
+        step(&emit_rand_ints);
+        REQUIRE(sum_everything.get_pending() == 5);
+        REQUIRE(emit_rand_ints.emit_count == 5);
+
+        sum_everything.set_chunksize(3);
+        step(&sum_everything);
+        REQUIRE(sum_everything.get_pending() == 2);
+        REQUIRE(sum_everything.sum == 3 * 7);
+    }
+
+    SECTION("Chunks larger than the inline buffer") {
+        emit_rand_ints.set_chunksize(16);
+        sum_everything.set_chunksize(32);
+        step(&emit_rand_ints);
+        REQUIRE(sum_everything.get_pending() == 16);
+
+        // The source declares Finished partway through its second chunk; the rest of the chunk is returned
+        auto status = step(&emit_rand_ints);
+        REQUIRE(status == JArrowMetrics::Status::Finished);
+        REQUIRE(sum_everything.get_pending() == 20);
+
+        step(&sum_everything);
+        REQUIRE(sum_everything.get_pending() == 0);
+        REQUIRE(sum_everything.sum == 20 * 7);
+    }
+
+    SECTION("Output reservations bound the chunk size") {
+        q1->set_threshold(4);
+        emit_rand_ints.set_chunksize(16);
+        step(&emit_rand_ints);
+        REQUIRE(sum_everything.get_pending() == 4);
+        REQUIRE(emit_rand_ints.emit_count == 4);
+    }
+}